@@ -0,0 +1,304 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "codegen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/* Generates synthetic grammars along several axes and times every stage of the generator
+ * on them. Every run prints one JSON object per line, so results can be diffed or plotted
+ * across commits. Usage: bench_generator [--smoke] [axis]; --smoke only runs the two smallest
+ * sizes of every axis, for a quick check under a sanitizer */
+
+#define BENCH_OUTPUT_PATH "bench_output.c"
+
+typedef struct BenchGrammar BenchGrammar;
+struct BenchGrammar
+{
+	Vector symbols;
+	Vector regexes;
+	Vector keywords;
+};
+
+static double Bench_Now(void)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+#endif
+}
+
+static char *Bench_Copy(const char *text)
+{
+	size_t size = strlen(text);
+	char *result = malloc(size + 1);
+	memcpy(result, text, size + 1);
+	return result;
+}
+static char *Bench_Format(const char *format, size_t value)
+{
+	int size = snprintf(NULL, 0, format, value);
+	char *result = malloc((size_t)size + 1);
+	snprintf(result, (size_t)size + 1, format, value);
+	return result;
+}
+/* Writes a distinct lowercase word for every index */
+static char *Bench_Word(const char *prefix, size_t index)
+{
+	char letters[32];
+	size_t size = 0;
+	do
+	{
+		letters[size++] = (char)('a' + index % 26);
+		index /= 26;
+	} while (index);
+	letters[size] = 0;
+	
+	size_t prefixSize = strlen(prefix);
+	char *result = malloc(prefixSize + size + 1);
+	memcpy(result, prefix, prefixSize);
+	memcpy(result + prefixSize, letters, size + 1);
+	return result;
+}
+
+static void BenchGrammar_Create(BenchGrammar *grammar)
+{
+	Vector_Create(&grammar->symbols, 16);
+	Vector_Create(&grammar->regexes, 16);
+	Vector_Create(&grammar->keywords, 16);
+}
+static void BenchGrammar_Destroy(BenchGrammar *grammar)
+{
+	for (size_t i = 0; i < grammar->symbols.size; ++i)
+	{
+		free(Vector_Get(&grammar->symbols, i));
+	}
+	for (size_t i = 0; i < grammar->regexes.size; ++i)
+	{
+		free(Vector_Get(&grammar->regexes, i));
+	}
+	for (size_t i = 0; i < grammar->keywords.size; ++i)
+	{
+		CodegenKeyword *keyword = Vector_Get(&grammar->keywords, i);
+		free((void *)keyword->symbol);
+		free((void *)keyword->text);
+		free(keyword);
+	}
+	Vector_Destroy(&grammar->symbols);
+	Vector_Destroy(&grammar->regexes);
+	Vector_Destroy(&grammar->keywords);
+}
+static void BenchGrammar_AddRule(BenchGrammar *grammar, char *symbol, char *regex)
+{
+	Vector_Push(&grammar->symbols, symbol);
+	Vector_Push(&grammar->regexes, regex);
+}
+static void BenchGrammar_AddKeyword(BenchGrammar *grammar, char *symbol, char *text, const char *base)
+{
+	CodegenKeyword *keyword = malloc(sizeof(CodegenKeyword));
+	keyword->symbol = symbol;
+	keyword->base = base;
+	keyword->text = text;
+	keyword->size = strlen(text);
+	Vector_Push(&grammar->keywords, keyword);
+}
+
+/* Identifiers with size keywords, which are classified by the perfect hash instead of the DFA */
+static void Bench_BuildKeywords(BenchGrammar *grammar, size_t size)
+{
+	BenchGrammar_AddRule(grammar, Bench_Copy("Whitespace"), Bench_Copy("[ \\t\\r\\n]+"));
+	BenchGrammar_AddRule(grammar, Bench_Copy("Identifier"), Bench_Copy("[a-z_][a-z0-9_]*"));
+	for (size_t i = 0; i < size; ++i)
+	{
+		BenchGrammar_AddKeyword(grammar, Bench_Format("Keyword%zu", i), Bench_Word("", i * 7919), "Identifier");
+	}
+}
+/* size rules that each match one word */
+static void Bench_BuildRules(BenchGrammar *grammar, size_t size)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		BenchGrammar_AddRule(grammar, Bench_Format("Rule%zu", i), Bench_Word("w", i * 7919));
+	}
+}
+/* size rules over overlapping wide character classes, told apart by their last word */
+static void Bench_BuildClasses(BenchGrammar *grammar, size_t size)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		char *word = Bench_Word("", i);
+		size_t regexSize = strlen(word) + 32;
+		char *regex = malloc(regexSize);
+		snprintf(regex, regexSize, "[%c-~][!-~]*:%s", (char)('!' + i % 64), word);
+		free(word);
+		BenchGrammar_AddRule(grammar, Bench_Format("Class%zu", i), regex);
+	}
+}
+/* One rule of size nested stars, ((a*b)*c)*... */
+static void Bench_BuildStars(BenchGrammar *grammar, size_t size)
+{
+	char *regex = malloc(size * 4 + 3);
+	char *c = regex;
+	for (size_t i = 0; i < size; ++i)
+	{
+		*c++ = '(';
+	}
+	*c++ = 'a';
+	for (size_t i = 0; i < size; ++i)
+	{
+		*c++ = '*';
+		*c++ = (char)('b' + i % 25);
+		*c++ = ')';
+	}
+	*c++ = '*';
+	*c = 0;
+	BenchGrammar_AddRule(grammar, Bench_Copy("Stars"), regex);
+}
+/* (a|b)*a(a|b)^size, whose DFA needs 2^(size + 1) states */
+static void Bench_BuildBlowup(BenchGrammar *grammar, size_t size)
+{
+	char *regex = malloc(size * 5 + 8);
+	memcpy(regex, "(a|b)*a", 7);
+	for (size_t i = 0; i < size; ++i)
+	{
+		memcpy(regex + 7 + i * 5, "(a|b)", 5);
+	}
+	regex[7 + size * 5] = 0;
+	BenchGrammar_AddRule(grammar, Bench_Copy("Blowup"), regex);
+}
+
+static void Bench_Run(const char *axis, size_t size, void (*build)(BenchGrammar *, size_t))
+{
+	BenchGrammar grammar;
+	BenchGrammar_Create(&grammar);
+	build(&grammar, size);
+	size_t rulesSize = grammar.symbols.size;
+	size_t keywordsSize = grammar.keywords.size;
+	
+	double parseBegin = Bench_Now();
+	NFA nfa;
+	NFA_Create(&nfa);
+	DFAEntry *entries = malloc((rulesSize ? rulesSize : 1) * sizeof(DFAEntry));
+	for (size_t i = 0; i < rulesSize; ++i)
+	{
+		entries[i].symbol = Vector_Get(&grammar.symbols, i);
+		entries[i].modes = 1;
+		entries[i].tags = 0;
+		NFA_ParseRegex(&nfa, Vector_Get(&grammar.regexes, i), &entries[i].expression);
+	}
+	
+	double constructBegin = Bench_Now();
+	DFA dfa;
+	DFA_Create(&dfa);
+	DFAState *start = NULL;
+	DFA_FromEntries(&dfa, entries, rulesSize, &start, 1);
+	size_t dfaStates = dfa.states.size;
+	size_t dfaBytes = dfa.allocator.peak;
+	
+	double minimizeBegin = Bench_Now();
+	DFA_Minimize(&dfa, &start, 1);
+	
+	double codegenBegin = Bench_Now();
+	CodegenOptions options;
+	memset(&options, 0, sizeof(CodegenOptions));
+	CodegenSymbol *symbols = calloc(rulesSize + keywordsSize, sizeof(CodegenSymbol));
+	CodegenKeyword *keywords = malloc((keywordsSize ? keywordsSize : 1) * sizeof(CodegenKeyword));
+	for (size_t i = 0; i < rulesSize; ++i)
+	{
+		symbols[i].name = Vector_Get(&grammar.symbols, i);
+	}
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		keywords[i] = *(CodegenKeyword *)Vector_Get(&grammar.keywords, i);
+		symbols[rulesSize + i].name = keywords[i].symbol;
+	}
+	FILE *output = NULL;
+	fopen_s(&output, BENCH_OUTPUT_PATH, "wb");
+	bool written = (output && Codegen_WriteSource(output, &options, &dfa, &start, 1, symbols, rulesSize + keywordsSize, keywords, keywordsSize, "bench_output.h"));
+	if (output)
+	{
+		fclose(output);
+	}
+	double codegenEnd = Bench_Now();
+	
+	size_t edges = 0;
+	for (size_t i = 0; i < dfa.states.size; ++i)
+	{
+		const DFAState *state = DFAStateVector_Get(&dfa.states, i);
+		for (size_t c = 0; c < DFASTATE_EDGES_MAX; ++c)
+		{
+			edges += (state->edges[c] != NULL);
+		}
+	}
+	
+	printf("{\"axis\": \"%s\", \"size\": %zu, \"rules\": %zu, \"keywords\": %zu, ", axis, size, rulesSize, keywordsSize);
+	printf("\"parseMs\": %.3f, \"constructMs\": %.3f, \"minimizeMs\": %.3f, \"codegenMs\": %.3f, ",
+		(constructBegin - parseBegin) * 1e3, (minimizeBegin - constructBegin) * 1e3, (codegenBegin - minimizeBegin) * 1e3, (codegenEnd - codegenBegin) * 1e3);
+	printf("\"nfaStates\": %zu, \"dfaStates\": %zu, \"states\": %zu, \"edges\": %zu, ", nfa.allocator.size / sizeof(NFAState), dfaStates, dfa.states.size, edges);
+	printf("\"nfaPeakBytes\": %zu, \"dfaPeakBytes\": %zu, \"codegen\": %s}\n", nfa.allocator.peak, dfaBytes, (written ? "true" : "false"));
+	fflush(stdout);
+	
+	free(keywords);
+	free(symbols);
+	DFA_Destroy(&dfa);
+	free(entries);
+	NFA_Destroy(&nfa);
+	BenchGrammar_Destroy(&grammar);
+}
+
+int main(int argc, char **argv)
+{
+	bool smoke = (argc > 1 && !strcmp(argv[1], "--smoke"));
+	const char *only = (argc > 1 + smoke ? argv[1 + smoke] : NULL);
+	
+	static const size_t k_keywordSizes[] = {10, 100, 1000, 10000, 100000};
+	static const size_t k_ruleSizes[] = {10, 100, 1000, 3000};
+	static const size_t k_classSizes[] = {10, 20, 50, 100};
+	static const size_t k_starSizes[] = {1, 4, 16, 64, 256};
+	static const size_t k_blowupSizes[] = {2, 4, 6, 8, 10, 12};
+	
+	struct
+	{
+		const char *axis;
+		void (*build)(BenchGrammar *, size_t);
+		const size_t *sizes;
+		size_t sizesSize;
+	} axes[] =
+	{
+		{"keywords", Bench_BuildKeywords, k_keywordSizes, sizeof(k_keywordSizes) / sizeof(size_t)},
+		{"rules", Bench_BuildRules, k_ruleSizes, sizeof(k_ruleSizes) / sizeof(size_t)},
+		{"classes", Bench_BuildClasses, k_classSizes, sizeof(k_classSizes) / sizeof(size_t)},
+		{"stars", Bench_BuildStars, k_starSizes, sizeof(k_starSizes) / sizeof(size_t)},
+		{"blowup", Bench_BuildBlowup, k_blowupSizes, sizeof(k_blowupSizes) / sizeof(size_t)}
+	};
+	
+	for (size_t i = 0; i < sizeof(axes) / sizeof(axes[0]); ++i)
+	{
+		if (only && strcmp(only, axes[i].axis))
+		{
+			continue;
+		}
+		for (size_t j = 0; j < axes[i].sizesSize && (!smoke || j < 2); ++j)
+		{
+			Bench_Run(axes[i].axis, axes[i].sizes[j], axes[i].build);
+		}
+	}
+	remove(BENCH_OUTPUT_PATH);
+	return 0;
+}
\ No newline at end of file
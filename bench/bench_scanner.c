@@ -0,0 +1,415 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include BENCH_HEADER
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BENCH_CYCLES 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES 1
+#endif
+
+/* Runs every backend of one generated scanner over a synthetic corpus for its grammar and
+ * prints one JSON object per backend. The scanner is chosen at compile time: BENCH_HEADER
+ * names its header, BENCH_GRAMMAR the corpus to generate and BENCH_FORMAT its table format.
+ * Usage: bench_scanner [megabytes] */
+
+#define BENCH_REPEATS 5
+#define BENCH_FRAGMENT_SIZE (64 * 1024)
+
+typedef struct BenchCorpus BenchCorpus;
+struct BenchCorpus
+{
+	char *data;
+	size_t size;
+	size_t capacity;
+};
+
+typedef struct BenchCount BenchCount;
+struct BenchCount
+{
+	size_t tokens;
+	size_t rejected;
+};
+
+static double Bench_Now(void)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+#endif
+}
+/* Time stamp counter ticks, which run at a fixed reference rate rather than the core clock */
+static uint64_t Bench_Cycles(void)
+{
+#if defined(BENCH_CYCLES)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+static size_t Bench_ThreadCount(void)
+{
+#if defined(_WIN32)
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return systemInfo.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0 ? (size_t)count : 1);
+#endif
+}
+
+/* A fixed xorshift generator, so every run scans the same corpus */
+static uint32_t Bench_Random(void)
+{
+	static uint32_t state = 2463534242u;
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+static const char *Bench_Pick(const char *const *choices, size_t choicesSize)
+{
+	return choices[Bench_Random() % choicesSize];
+}
+
+static void BenchCorpus_Append(BenchCorpus *corpus, const char *text)
+{
+	size_t size = strlen(text);
+	if (corpus->size + size + 1 > corpus->capacity)
+	{
+		corpus->capacity = (corpus->capacity + size + 1) * 2;
+		corpus->data = realloc(corpus->data, corpus->capacity);
+	}
+	memcpy(corpus->data + corpus->size, text, size + 1);
+	corpus->size += size;
+}
+static void BenchCorpus_Format(BenchCorpus *corpus, const char *format, unsigned value)
+{
+	char text[64];
+	snprintf(text, sizeof(text), format, value);
+	BenchCorpus_Append(corpus, text);
+}
+
+static const char *const k_identifiers[] = {"count", "buffer", "node", "i", "j", "result", "next_state", "CLex_Transition", "table", "size", "value", "user"};
+
+static void Bench_BuildCStatement(BenchCorpus *corpus, unsigned depth)
+{
+	static const char *const k_operators[] = {"+", "-", "*", "/", "%", "==", "!=", "<", "<=", ">", ">=", "&&", "||", "&", "|"};
+	const char *left = Bench_Pick(k_identifiers, sizeof(k_identifiers) / sizeof(k_identifiers[0]));
+	const char *right = Bench_Pick(k_identifiers, sizeof(k_identifiers) / sizeof(k_identifiers[0]));
+	const char *operator = Bench_Pick(k_operators, sizeof(k_operators) / sizeof(k_operators[0]));
+	for (unsigned i = 0; i < depth; ++i)
+	{
+		BenchCorpus_Append(corpus, "\t");
+	}
+	switch (Bench_Random() % 8)
+	{
+		case 0:
+			BenchCorpus_Format(corpus, "/* step %u: keep the invariant\n\t * across both branches */\n", Bench_Random() % 100);
+			break;
+		case 1:
+			BenchCorpus_Format(corpus, "// %u entries are left\n", Bench_Random() % 1000);
+			break;
+		case 2:
+			BenchCorpus_Format(corpus, "printf(\"%%d items\\n\", %u);\n", Bench_Random() % 1000);
+			break;
+		case 3:
+			BenchCorpus_Append(corpus, "if (");
+			BenchCorpus_Append(corpus, left);
+			BenchCorpus_Append(corpus, " ");
+			BenchCorpus_Append(corpus, operator);
+			BenchCorpus_Format(corpus, " 0x%X)\n", Bench_Random() % 4096);
+			for (unsigned i = 0; i < depth; ++i)
+			{
+				BenchCorpus_Append(corpus, "\t");
+			}
+			BenchCorpus_Append(corpus, "{\n");
+			if (depth < 4)
+			{
+				Bench_BuildCStatement(corpus, depth + 1);
+			}
+			for (unsigned i = 0; i < depth; ++i)
+			{
+				BenchCorpus_Append(corpus, "\t");
+			}
+			BenchCorpus_Append(corpus, "}\n");
+			break;
+		case 4:
+			BenchCorpus_Append(corpus, "for (int i = 0; i < ");
+			BenchCorpus_Append(corpus, right);
+			BenchCorpus_Append(corpus, "; ++i) ");
+			BenchCorpus_Append(corpus, left);
+			BenchCorpus_Append(corpus, "[i] = '\\0';\n");
+			break;
+		case 5:
+			BenchCorpus_Append(corpus, "return ");
+			BenchCorpus_Append(corpus, left);
+			BenchCorpus_Append(corpus, "->");
+			BenchCorpus_Append(corpus, right);
+			BenchCorpus_Append(corpus, ";\n");
+			break;
+		default:
+			BenchCorpus_Append(corpus, left);
+			BenchCorpus_Append(corpus, " = ");
+			BenchCorpus_Append(corpus, right);
+			BenchCorpus_Append(corpus, " ");
+			BenchCorpus_Append(corpus, operator);
+			BenchCorpus_Format(corpus, " %u;\n", Bench_Random() % 100000);
+			break;
+	}
+}
+static void Bench_BuildC(BenchCorpus *corpus, size_t size)
+{
+	while (corpus->size < size)
+	{
+		BenchCorpus_Append(corpus, "#include \"clex.h\"\n\nstatic int ");
+		BenchCorpus_Append(corpus, Bench_Pick(k_identifiers, sizeof(k_identifiers) / sizeof(k_identifiers[0])));
+		BenchCorpus_Format(corpus, "_%u(struct node *node, char *buffer)\n{\n", Bench_Random() % 1000);
+		for (unsigned i = Bench_Random() % 12 + 4; i > 0; --i)
+		{
+			Bench_BuildCStatement(corpus, 1);
+		}
+		BenchCorpus_Append(corpus, "}\n\n");
+	}
+}
+
+static void Bench_BuildJSONValue(BenchCorpus *corpus, unsigned depth)
+{
+	static const char *const k_keys[] = {"\"id\"", "\"name\"", "\"tags\"", "\"price\"", "\"enabled\"", "\"owner\"", "\"path\\/to\"", "\"description\""};
+	unsigned kind = (depth < 5 ? Bench_Random() % 8 : Bench_Random() % 5);
+	switch (kind)
+	{
+		case 0:
+			BenchCorpus_Format(corpus, "%u", Bench_Random() % 100000);
+			break;
+		case 1:
+			BenchCorpus_Format(corpus, "-%u.25e-3", Bench_Random() % 1000);
+			break;
+		case 2:
+			BenchCorpus_Format(corpus, "\"item %u with \\\"quotes\\\" and \\u00e9\"", Bench_Random() % 1000);
+			break;
+		case 3:
+			BenchCorpus_Append(corpus, Bench_Random() % 2 ? "true" : "false");
+			break;
+		case 4:
+			BenchCorpus_Append(corpus, "null");
+			break;
+		case 5:
+		{
+			BenchCorpus_Append(corpus, "[");
+			for (unsigned i = Bench_Random() % 6; i > 0; --i)
+			{
+				Bench_BuildJSONValue(corpus, depth + 1);
+				BenchCorpus_Append(corpus, (i > 1 ? ", " : ""));
+			}
+			BenchCorpus_Append(corpus, "]");
+			break;
+		}
+		default:
+		{
+			BenchCorpus_Append(corpus, "{\n");
+			for (unsigned i = Bench_Random() % 6 + 1; i > 0; --i)
+			{
+				for (unsigned j = 0; j <= depth; ++j)
+				{
+					BenchCorpus_Append(corpus, "  ");
+				}
+				BenchCorpus_Append(corpus, Bench_Pick(k_keys, sizeof(k_keys) / sizeof(k_keys[0])));
+				BenchCorpus_Append(corpus, ": ");
+				Bench_BuildJSONValue(corpus, depth + 1);
+				BenchCorpus_Append(corpus, (i > 1 ? ",\n" : "\n"));
+			}
+			for (unsigned j = 0; j < depth; ++j)
+			{
+				BenchCorpus_Append(corpus, "  ");
+			}
+			BenchCorpus_Append(corpus, "}");
+			break;
+		}
+	}
+}
+static void Bench_BuildJSON(BenchCorpus *corpus, size_t size)
+{
+	BenchCorpus_Append(corpus, "[\n");
+	while (corpus->size < size)
+	{
+		Bench_BuildJSONValue(corpus, 0);
+		BenchCorpus_Append(corpus, ",\n");
+	}
+	BenchCorpus_Append(corpus, "null\n]\n");
+}
+
+static void Bench_BuildLog(BenchCorpus *corpus, size_t size)
+{
+	static const char *const k_levels[] = {"DEBUG", "INFO", "INFO", "INFO", "WARN", "ERROR"};
+	static const char *const k_paths[] = {"/api/v1/items", "/api/v1/items/search", "/static/app.min.js", "/health", "/api/v2/users/me"};
+	static const char *const k_messages[] = {"request finished", "cache miss", "retrying upstream", "slow query"};
+	while (corpus->size < size)
+	{
+		unsigned second = Bench_Random() % 86400;
+		BenchCorpus_Format(corpus, "2024-05-01T%02u:", second / 3600);
+		BenchCorpus_Format(corpus, "%02u:", second / 60 % 60);
+		BenchCorpus_Format(corpus, "%02u.", second % 60);
+		BenchCorpus_Format(corpus, "%03uZ ", Bench_Random() % 1000);
+		BenchCorpus_Append(corpus, Bench_Pick(k_levels, sizeof(k_levels) / sizeof(k_levels[0])));
+		BenchCorpus_Format(corpus, " [worker-%u] ", Bench_Random() % 16);
+		BenchCorpus_Append(corpus, Bench_Pick(k_messages, sizeof(k_messages) / sizeof(k_messages[0])));
+		BenchCorpus_Format(corpus, " id=%u path=", Bench_Random());
+		BenchCorpus_Append(corpus, Bench_Pick(k_paths, sizeof(k_paths) / sizeof(k_paths[0])));
+		BenchCorpus_Format(corpus, " status=%u", (Bench_Random() % 4 ? 200 : 404));
+		BenchCorpus_Format(corpus, " took=%ums", Bench_Random() % 2000);
+		BenchCorpus_Append(corpus, (Bench_Random() % 8 ? "\n" : " agent=\"curl/8.5.0\"\n"));
+	}
+}
+
+static void Bench_CountToken(void *user, TokenType type, const char *token, size_t size)
+{
+	BenchCount *count = user;
+	++count->tokens;
+	count->rejected += (type == TokenType_CLex_Reject);
+	(void)token;
+	(void)size;
+}
+static void Bench_CountFragment(void *user, TokenType type, size_t size)
+{
+	Bench_CountToken(user, type, NULL, size);
+}
+
+static void Bench_ScanPull(const BenchCorpus *corpus, BenchCount *count)
+{
+	const char *cursor = corpus->data;
+	while (*cursor)
+	{
+		TokenType type = CLex(&cursor);
+		Bench_CountToken(count, type, NULL, 0);
+		if (type == TokenType_CLex_Reject)
+		{
+			break;
+		}
+	}
+}
+static void Bench_ScanPush(const BenchCorpus *corpus, BenchCount *count)
+{
+	CLexContext context;
+	CLex_Begin(&context);
+	for (size_t offset = 0; offset < corpus->size; offset += BENCH_FRAGMENT_SIZE)
+	{
+		size_t size = (corpus->size - offset < BENCH_FRAGMENT_SIZE ? corpus->size - offset : BENCH_FRAGMENT_SIZE);
+		if (CLex_Feed(&context, corpus->data + offset, size, Bench_CountFragment, count) != size)
+		{
+			return;
+		}
+	}
+	CLex_End(&context, Bench_CountFragment, count);
+}
+static void Bench_ScanBatch(const BenchCorpus *corpus, BenchCount *count)
+{
+	CLex_Tokenize(corpus->data, corpus->size, Bench_CountToken, count);
+}
+static void Bench_ScanParallel(const BenchCorpus *corpus, BenchCount *count)
+{
+	CLex_TokenizeParallel(corpus->data, corpus->size, Bench_ThreadCount(), Bench_CountToken, count);
+}
+
+int main(int argc, char **argv)
+{
+	size_t megabytes = (argc > 1 ? strtoul(argv[1], NULL, 10) : 16);
+	size_t size = megabytes * 1024 * 1024;
+	
+	BenchCorpus corpus = {NULL, 0, 0};
+	BenchCorpus_Append(&corpus, "");
+	if (!strcmp(BENCH_GRAMMAR, "c"))
+	{
+		Bench_BuildC(&corpus, size);
+	}
+	else if (!strcmp(BENCH_GRAMMAR, "json"))
+	{
+		Bench_BuildJSON(&corpus, size);
+	}
+	else
+	{
+		Bench_BuildLog(&corpus, size);
+	}
+	
+	struct
+	{
+		const char *name;
+		void (*scan)(const BenchCorpus *, BenchCount *);
+	} backends[] =
+	{
+		{"pull", Bench_ScanPull},
+		{"push", Bench_ScanPush},
+		{"batch", Bench_ScanBatch},
+		{"parallel", Bench_ScanParallel}
+	};
+	
+	size_t expectedTokens = 0;
+	int result = 0;
+	for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); ++i)
+	{
+		/* Keep the fastest of several runs, which is the least disturbed by the rest of the system */
+		BenchCount count = {0, 0};
+		double seconds = 0.0;
+		uint64_t cycles = 0;
+		for (size_t repeat = 0; repeat < BENCH_REPEATS; ++repeat)
+		{
+			BenchCount runCount = {0, 0};
+			double begin = Bench_Now();
+			uint64_t cyclesBegin = Bench_Cycles();
+			backends[i].scan(&corpus, &runCount);
+			uint64_t cyclesEnd = Bench_Cycles();
+			double end = Bench_Now();
+			if (repeat == 0 || end - begin < seconds)
+			{
+				seconds = end - begin;
+				cycles = cyclesEnd - cyclesBegin;
+			}
+			count = runCount;
+		}
+		
+		if (i == 0)
+		{
+			expectedTokens = count.tokens;
+		}
+		bool valid = (count.rejected == 0 && count.tokens == expectedTokens);
+		result |= !valid;
+		
+		printf("{\"grammar\": \"%s\", \"format\": \"%s\", \"backend\": \"%s\", \"bytes\": %zu, \"tokens\": %zu, ", BENCH_GRAMMAR, BENCH_FORMAT, backends[i].name, corpus.size, count.tokens);
+		printf("\"mbPerSecond\": %.1f, \"tokensPerSecond\": %.0f, ", (double)corpus.size / seconds / 1e6, (double)count.tokens / seconds);
+#if defined(BENCH_CYCLES)
+		printf("\"cyclesPerByte\": %.3f, ", (double)cycles / (double)corpus.size);
+#else
+		printf("\"cyclesPerByte\": null, ");
+#endif
+		printf("\"valid\": %s}\n", (valid ? "true" : "false"));
+		fflush(stdout);
+	}
+	
+	free(corpus.data);
+	return result;
+}
\ No newline at end of file
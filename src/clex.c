@@ -1,22 +1,197 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "codegen.h"
 
 #include <ctype.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
 
 typedef struct InputRule InputRule;
 struct InputRule
 {
 	const char *symbol;
 	const char *regex;
+	const char *keywordBase;
+	CodegenValue value;
+	bool intern;
+	size_t modes;
+};
+
+typedef enum Layout Layout;
+enum Layout
+{
+	Layout_BFS,
+	Layout_Hot
+};
+
+/* Starts every cache file and identifies its layout; the automaton in it is identified by the generator hash */
+#define CACHE_MAGIC "CLEXDFA1"
+
+typedef enum StatsPhase StatsPhase;
+enum StatsPhase
+{
+	StatsPhase_Parse,
+	StatsPhase_NFA,
+	StatsPhase_Construct,
+	StatsPhase_Minimize,
+	StatsPhase_Codegen,
+	StatsPhase_Count
+};
+
+typedef struct Stats Stats;
+struct Stats
+{
+	double seconds[StatsPhase_Count];
+	size_t nfaStates;
+	size_t dfaStates;
+	size_t minimizedStates;
+	size_t classes;
+	size_t tableSize;
+	bool cached;
+	/* Peak bytes of each StackAllocator; the DFA figure is the subset construction's, or the cache load's, taken
+	 * before minimization replaces that allocator with its own */
+	size_t nfaPeak;
+	size_t keysPeak;
+	size_t dfaPeak;
+	size_t minimizedPeak;
+	/* Blocks taken from malloc, and from the free list that emptied allocators return them to */
+	size_t blocksAllocated;
+	size_t blocksReused;
 };
 
-void ParseInputRules(const char *inputPath, InputRule **inputRules, size_t *inputRulesSize)
+/* Parses "%name(argument)" and returns a copy of argument, or NULL if the attribute is malformed */
+static char *ParseAttribute(const char **c, const char *name)
+{
+	size_t nameSize = strlen(name);
+	if (strncmp(*c + 1, name, nameSize) || (*c)[nameSize + 1] != '(')
+	{
+		return NULL;
+	}
+	const char *argumentStart = *c + nameSize + 2;
+	const char *argumentEnd = argumentStart;
+	while (*argumentEnd && *argumentEnd != ')' && !isspace(*argumentEnd))
+	{
+		++argumentEnd;
+	}
+	if (*argumentEnd != ')' || argumentEnd == argumentStart)
+	{
+		return NULL;
+	}
+	
+	size_t argumentSize = argumentEnd - argumentStart;
+	char *argument = malloc(argumentSize + 1);
+	memcpy(argument, argumentStart, argumentSize);
+	argument[argumentSize] = 0;
+	*c = argumentEnd + 1;
+	return argument;
+}
+
+/* Parses "%name" without an argument */
+static bool ParseFlag(const char **c, const char *name)
+{
+	size_t nameSize = strlen(name);
+	if (strncmp(*c + 1, name, nameSize) || ((*c)[nameSize + 1] && !isspace((*c)[nameSize + 1])))
+	{
+		return false;
+	}
+	*c += nameSize + 1;
+	return true;
+}
+
+/* Returns the value action named by a %value attribute, or CodegenValue_None if there is none */
+static CodegenValue ParseValue(const char *name)
+{
+	static const char *names[] = {NULL, "decimal", "hex", "hash", "escapes"};
+	for (int value = CodegenValue_Decimal; value <= CodegenValue_Escapes; ++value)
+	{
+		if (!strcmp(name, names[value]))
+		{
+			return (CodegenValue)value;
+		}
+	}
+	return CodegenValue_None;
+}
+
+/* Parses "<ModeA,ModeB>" or "<*>" into a mask of mode indices, adding modes not seen before */
+static bool ParseModes(const char **c, char ***modes, size_t *modesSize, size_t *mask)
+{
+	++*c;
+	*mask = 0;
+	if (**c == '*' && (*c)[1] == '>')
+	{
+		*c += 2;
+		*mask = ~(size_t)0;
+		return true;
+	}
+	
+	for (;;)
+	{
+		const char *nameStart = *c;
+		while (isalnum(**c) || **c == '_')
+		{
+			++*c;
+		}
+		size_t nameSize = *c - nameStart;
+		if (!nameSize)
+		{
+			return false;
+		}
+		
+		size_t mode = 0;
+		while (mode < *modesSize && (strlen((*modes)[mode]) != nameSize || strncmp((*modes)[mode], nameStart, nameSize)))
+		{
+			++mode;
+		}
+		if (mode == *modesSize)
+		{
+			if (*modesSize == DFA_MODES_MAX)
+			{
+				return false;
+			}
+			char *name = malloc(nameSize + 1);
+			memcpy(name, nameStart, nameSize);
+			name[nameSize] = 0;
+			*modes = realloc(*modes, (*modesSize + 1) * sizeof(char *));
+			(*modes)[(*modesSize)++] = name;
+		}
+		*mask |= (size_t)1 << mode;
+		
+		if (**c == '>')
+		{
+			++*c;
+			return true;
+		}
+		if (**c != ',')
+		{
+			return false;
+		}
+		++*c;
+	}
+}
+
+bool ParseInputRules(const char *inputPath, InputRule **inputRules, size_t *inputRulesSize, char ***modes, size_t *modesSize)
 {
 	size_t capacity = 16;
 	*inputRulesSize = 0;
 	*inputRules = malloc(capacity * sizeof(InputRule));
 	
+	/* Rules without a mode list belong to the Default mode only */
+	*modes = malloc(sizeof(char *));
+	(*modes)[0] = malloc(sizeof("Default"));
+	memcpy((*modes)[0], "Default", sizeof("Default"));
+	*modesSize = 1;
+	
 	FILE *input;
 	fopen_s(&input, inputPath, "rb");
 	
@@ -42,6 +217,22 @@ void ParseInputRules(const char *inputPath, InputRule **inputRules, size_t *inpu
 			break;
 		}
 		
+		size_t ruleModes = 1;
+		if (*c == '<')
+		{
+			const char *modesStart = c;
+			if (!ParseModes(&c, modes, modesSize, &ruleModes))
+			{
+				const char *modesEnd = modesStart;
+				while (*modesEnd && !isspace(*modesEnd))
+				{
+					++modesEnd;
+				}
+				fprintf(stderr, "clex: invalid mode list %.*s\n", (int)(modesEnd - modesStart), modesStart);
+				return false;
+			}
+		}
+		
 		const char *symbolStart = c;
 		
 		while (*c && !isspace(*c))
@@ -56,6 +247,46 @@ void ParseInputRules(const char *inputPath, InputRule **inputRules, size_t *inpu
 			++c;
 		}
 		
+		const char *keywordBase = NULL;
+		CodegenValue value = CodegenValue_None;
+		bool intern = false;
+		while (*c == '%')
+		{
+			const char *attributeStart = c;
+			bool valid = false;
+			char *argument = ParseAttribute(&c, "keyword");
+			if (argument)
+			{
+				valid = !keywordBase;
+				free((void *)keywordBase);
+				keywordBase = argument;
+			}
+			else if ((argument = ParseAttribute(&c, "value")))
+			{
+				valid = (value == CodegenValue_None && (value = ParseValue(argument)) != CodegenValue_None);
+				free(argument);
+			}
+			else if (ParseFlag(&c, "intern"))
+			{
+				valid = !intern;
+				intern = true;
+			}
+			if (!valid)
+			{
+				const char *attributeEnd = attributeStart;
+				while (*attributeEnd && !isspace(*attributeEnd))
+				{
+					++attributeEnd;
+				}
+				fprintf(stderr, "clex: invalid attribute %.*s\n", (int)(attributeEnd - attributeStart), attributeStart);
+				return false;
+			}
+			while (*c && isspace(*c))
+			{
+				++c;
+			}
+		}
+		
 		const char *regexStart = c;
 		
 		while (*c && *c != '\r' && *c != '\n')
@@ -86,14 +317,345 @@ void ParseInputRules(const char *inputPath, InputRule **inputRules, size_t *inpu
 		memcpy(regex, regexStart, regexSize);
 		regex[regexSize] = 0;
 		(*inputRules)[*inputRulesSize].regex = regex;
+		(*inputRules)[*inputRulesSize].keywordBase = keywordBase;
+		(*inputRules)[*inputRulesSize].value = value;
+		(*inputRules)[*inputRulesSize].intern = intern;
+		(*inputRules)[*inputRulesSize].modes = ruleModes;
 		
 		++*inputRulesSize;
 	}
+	return true;
+}
+
+/* Returns the string a keyword rule matches, or NULL if its regex is not a plain string */
+char *ParseKeywordText(const char *regex, size_t *size)
+{
+	char *text = malloc(strlen(regex) + 1);
+	*size = 0;
+	for (const char *c = regex; *c; ++c)
+	{
+		char value = *c;
+		if (value == '\\' && c[1])
+		{
+			++c;
+			switch (*c)
+			{
+				case 't':
+					value = '\t';
+					break;
+				case 'r':
+					value = '\r';
+					break;
+				case 'n':
+					value = '\n';
+					break;
+				default:
+					value = *c;
+					break;
+			}
+		}
+		else if (strchr("()[]|*+?.", value))
+		{
+			free(text);
+			return NULL;
+		}
+		text[(*size)++] = value;
+	}
+	if (!*size)
+	{
+		free(text);
+		return NULL;
+	}
+	return text;
+}
+
+bool MatchesKeyword(const DFAState *start, const CodegenKeyword *keyword)
+{
+	const DFAState *state = start;
+	for (size_t i = 0; i < keyword->size && state; ++i)
+	{
+		unsigned char c = (unsigned char)keyword->text[i];
+		state = (c < DFASTATE_EDGES_MAX ? state->edges[c] : NULL);
+	}
+	return state && state->symbol && !strcmp(state->symbol, keyword->base);
+}
+
+char *ReadFile(const char *path, size_t *size)
+{
+	FILE *input;
+	if (fopen_s(&input, path, "rb") || !input)
+	{
+		return NULL;
+	}
+	
+	fseek(input, 0, SEEK_END);
+	*size = ftell(input);
+	fseek(input, 0, SEEK_SET);
+	
+	char *file = malloc(*size + 1);
+	*size = fread(file, 1, *size, input);
+	file[*size] = 0;
+	
+	fclose(input);
+	return file;
+}
+
+uint64_t HashBytes(uint64_t hash, const void *data, size_t size)
+{
+	/* FNV-1a */
+	const unsigned char *bytes = data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+/* Outputs are written next to their path first and only replace it if they differ, so that an unchanged
+ * output keeps its timestamp and nothing that depends on it rebuilds */
+char *GetTemporaryPath(const char *path)
+{
+	size_t size = strlen(path);
+	char *result = malloc(size + sizeof(".tmp"));
+	memcpy(result, path, size);
+	memcpy(result + size, ".tmp", sizeof(".tmp"));
+	return result;
+}
+bool ReplaceIfChanged(const char *temporaryPath, const char *path)
+{
+	size_t newSize = 0;
+	size_t oldSize = 0;
+	char *newFile = ReadFile(temporaryPath, &newSize);
+	char *oldFile = ReadFile(path, &oldSize);
+	bool changed = (!oldFile || newSize != oldSize || memcmp(newFile, oldFile, newSize));
+	free(newFile);
+	free(oldFile);
+	
+	if (!changed)
+	{
+		remove(temporaryPath);
+		return true;
+	}
+	remove(path);
+	if (rename(temporaryPath, path))
+	{
+		fprintf(stderr, "clex: could not write %s\n", path);
+		return false;
+	}
+	return true;
+}
+
+/* Adds the transitions in each "state index transitions type" line of a CLex_DumpProfile dump to weights.
+ * Indices are those of a scanner generated without --layout hot, which only depend on the grammar */
+bool ReadProfileData(const char *path, const DFA *dfa, size_t *weights)
+{
+	size_t fileSize;
+	char *file = ReadFile(path, &fileSize);
+	if (!file)
+	{
+		fprintf(stderr, "clex: could not open %s\n", path);
+		return false;
+	}
+	
+	bool result = true;
+	const char *c = file;
+	while (*c && result)
+	{
+		const char *lineEnd = c;
+		while (*lineEnd && *lineEnd != '\n')
+		{
+			++lineEnd;
+		}
+		
+		if (!strncmp(c, "state ", 6))
+		{
+			char *end;
+			size_t index = (size_t)strtoull(c + 6, &end, 10);
+			size_t transitions = (size_t)strtoull(end, &end, 10);
+			while (end < lineEnd && *end == ' ')
+			{
+				++end;
+			}
+			size_t nameSize = lineEnd - end;
+			while (nameSize && isspace(end[nameSize - 1]))
+			{
+				--nameSize;
+			}
+			
+			const DFAState *state = (index && index <= dfa->states.size ? DFAStateVector_Get(&dfa->states, index - 1) : NULL);
+			const char *name = (state && state->symbol ? state->symbol : "CLex_Reject");
+			result = (state && strlen(name) == nameSize && !strncmp(name, end, nameSize));
+			if (result)
+			{
+				weights[index - 1] += transitions;
+			}
+		}
+		c = lineEnd + (*lineEnd != 0);
+	}
+	free(file);
+	
+	if (!result)
+	{
+		fprintf(stderr, "clex: profile %s does not match the grammar; profile a scanner generated without --layout hot\n", path);
+	}
+	return result;
+}
+
+/* Identifies the generator that builds a cached automaton: DFA_VERSION, and the clex executable itself, so that
+ * a rebuilt generator does not read the entries of another build even if the version was not changed */
+uint64_t HashGenerator()
+{
+	uint64_t version = DFA_VERSION;
+	uint64_t hash = HashBytes(0xCBF29CE484222325ull, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	hash = HashBytes(hash, &version, sizeof(uint64_t));
+	
+#if defined(_WIN32)
+	char *path = NULL;
+	_get_pgmptr(&path);
+#elif defined(__linux__)
+	const char *path = "/proc/self/exe";
+#else
+	const char *path = NULL;
+#endif
+	size_t size;
+	char *executable = (path ? ReadFile(path, &size) : NULL);
+	if (executable)
+	{
+		hash = HashBytes(hash, executable, size);
+		free(executable);
+	}
+	else
+	{
+		/* Without the executable, when this file was compiled is the closest identity of the build */
+		hash = HashBytes(hash, __DATE__ " " __TIME__, sizeof(__DATE__ " " __TIME__));
+	}
+	return hash;
+}
+
+/* The minimized DFA only depends on the generator, the rules that are not keywords, their modes and the number
+ * of modes */
+char *GetCachePath(const char *directory, const InputRule *inputRules, size_t inputRulesSize, size_t modesSize)
+{
+	uint64_t key = HashGenerator();
+	uint64_t modes = modesSize;
+	key = HashBytes(key, &modes, sizeof(uint64_t));
+	for (size_t i = 0; i < inputRulesSize; ++i)
+	{
+		if (!inputRules[i].keywordBase)
+		{
+			modes = inputRules[i].modes;
+			key = HashBytes(key, inputRules[i].symbol, strlen(inputRules[i].symbol) + 1);
+			key = HashBytes(key, inputRules[i].regex, strlen(inputRules[i].regex) + 1);
+			key = HashBytes(key, &modes, sizeof(uint64_t));
+		}
+	}
+	
+	size_t size = strlen(directory) + sizeof("/0123456789ABCDEF.dfa");
+	char *result = malloc(size);
+	snprintf(result, size, "%s/%016llX.dfa", directory, (unsigned long long)key);
+	return result;
+}
+bool LoadCache(const char *path, DFA *dfa, DFAState **starts, size_t startsSize, const DFAEntry *entries, size_t entriesSize)
+{
+	FILE *input;
+	if (fopen_s(&input, path, "rb") || !input)
+	{
+		return false;
+	}
+	
+	char magic[sizeof(CACHE_MAGIC) - 1];
+	bool result = (fread(magic, 1, sizeof(magic), input) == sizeof(magic) && !memcmp(magic, CACHE_MAGIC, sizeof(magic)) &&
+		DFA_Load(dfa, starts, startsSize, entries, entriesSize, input));
+	fclose(input);
+	if (!result)
+	{
+		fprintf(stderr, "clex: warning: ignoring malformed cache entry %s\n", path);
+		DFA_Destroy(dfa);
+		DFA_Create(dfa);
+	}
+	return result;
+}
+void SaveCache(const char *directory, const char *path, const DFA *dfa, DFAState *const *starts, size_t startsSize, const DFAEntry *entries, size_t entriesSize)
+{
+#if defined(_WIN32)
+	_mkdir(directory);
+#else
+	mkdir(directory, 0777);
+#endif
+	
+	/* Written aside and moved in place, so that a reader never sees half an entry */
+	char *temporaryPath = GetTemporaryPath(path);
+	FILE *output;
+	if (fopen_s(&output, temporaryPath, "wb") || !output)
+	{
+		fprintf(stderr, "clex: warning: could not write cache entry %s\n", path);
+		free(temporaryPath);
+		return;
+	}
+	fwrite(CACHE_MAGIC, 1, sizeof(CACHE_MAGIC) - 1, output);
+	DFA_Save(dfa, starts, startsSize, entries, entriesSize, output);
+	fclose(output);
+	
+	remove(path);
+	if (rename(temporaryPath, path))
+	{
+		remove(temporaryPath);
+	}
+	free(temporaryPath);
+}
+
+/* Monotonic, so phase times cannot go negative or jump when the wall clock is adjusted */
+double GetSeconds()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+#endif
+}
+
+void PrintStats(const Stats *stats, bool json)
+{
+	static const char *const k_phaseNames[StatsPhase_Count] = {"parse", "nfa", "construct", "minimize", "codegen"};
+	
+	if (json)
+	{
+		printf("{");
+		for (int i = 0; i < StatsPhase_Count; ++i)
+		{
+			printf("\"%sMs\": %.3f, ", k_phaseNames[i], stats->seconds[i] * 1e3);
+		}
+		printf("\"nfaStates\": %zu, \"dfaStates\": %zu, \"minimizedStates\": %zu, \"classes\": %zu, \"tableBytes\": %zu, ", stats->nfaStates, stats->dfaStates, stats->minimizedStates, stats->classes, stats->tableSize);
+		printf("\"cached\": %s, ", (stats->cached ? "true" : "false"));
+		printf("\"nfaPeakBytes\": %zu, \"keysPeakBytes\": %zu, \"dfaPeakBytes\": %zu, \"minimizedPeakBytes\": %zu, ", stats->nfaPeak, stats->keysPeak, stats->dfaPeak, stats->minimizedPeak);
+		printf("\"blocksAllocated\": %zu, \"blocksReused\": %zu}\n", stats->blocksAllocated, stats->blocksReused);
+		return;
+	}
+	
+	double total = 0.0;
+	for (int i = 0; i < StatsPhase_Count; ++i)
+	{
+		printf("%-10s %10.3f ms\n", k_phaseNames[i], stats->seconds[i] * 1e3);
+		total += stats->seconds[i];
+	}
+	printf("%-10s %10.3f ms\n", "total", total * 1e3);
+	printf("states     %zu nfa, %zu dfa, %zu minimized%s\n", stats->nfaStates, stats->dfaStates, stats->minimizedStates, (stats->cached ? " (cached)" : ""));
+	printf("classes    %zu\n", stats->classes);
+	printf("tables     %zu bytes\n", stats->tableSize);
+	printf("peak       %zu nfa, %zu keys, %zu dfa, %zu minimized bytes\n", stats->nfaPeak, stats->keysPeak, stats->dfaPeak, stats->minimizedPeak);
+	printf("blocks     %zu allocated, %zu reused\n", stats->blocksAllocated, stats->blocksReused);
 }
 
 void PrintUsage()
 {
-	printf("Usage: clex input -o header source\n");
+	printf("Usage: clex input [-o header source] [--cpp header] [--push] [--stream] [--mmap] [--parallel] [--many] [--stride2] [--stride2-limit bytes] [--incremental] [--sync] [--lines] [--recover] [--profile] [--layout bfs|hot] [--train corpus] [--profile-data profile] [--cache directory] [--stats] [--stats-json]\n");
 }
 
 int main(int argc, char **argv)
@@ -102,6 +664,16 @@ int main(int argc, char **argv)
 	const char *inputPath = NULL;
 	const char *outputHeaderPath = NULL;
 	const char *outputSourcePath = NULL;
+	const char *outputCppPath = NULL;
+	CodegenOptions options;
+	memset(&options, 0, sizeof(CodegenOptions));
+	options.stride2Limit = 256 * 1024;
+	Layout layout = Layout_BFS;
+	const char *trainPath = NULL;
+	const char *profileDataPath = NULL;
+	const char *cacheDirectory = NULL;
+	bool stats = false;
+	bool statsJson = false;
 	
 	for (int i = 1; i < argc; ++i)
 	{
@@ -112,66 +684,467 @@ int main(int argc, char **argv)
 			++i;
 			outputSourcePath = argv[i];
 		}
+		else if (!strcmp(argv[i], "--cpp"))
+		{
+			++i;
+			if (i == argc)
+			{
+				PrintUsage();
+				return -1;
+			}
+			outputCppPath = argv[i];
+		}
+		else if (!strcmp(argv[i], "--push"))
+		{
+			options.push = true;
+		}
+		else if (!strcmp(argv[i], "--stream"))
+		{
+			options.stream = true;
+		}
+		else if (!strcmp(argv[i], "--mmap"))
+		{
+			options.mmap = true;
+		}
+		else if (!strcmp(argv[i], "--parallel"))
+		{
+			options.parallel = true;
+		}
+		else if (!strcmp(argv[i], "--many"))
+		{
+			options.many = true;
+		}
+		else if (!strcmp(argv[i], "--stride2"))
+		{
+			options.stride2 = true;
+		}
+		else if (!strcmp(argv[i], "--stride2-limit"))
+		{
+			++i;
+			if (i == argc)
+			{
+				PrintUsage();
+				return -1;
+			}
+			options.stride2Limit = strtoul(argv[i], NULL, 10);
+		}
+		else if (!strcmp(argv[i], "--incremental"))
+		{
+			options.incremental = true;
+		}
+		else if (!strcmp(argv[i], "--sync"))
+		{
+			options.sync = true;
+		}
+		else if (!strcmp(argv[i], "--lines"))
+		{
+			options.lines = true;
+		}
+		else if (!strcmp(argv[i], "--recover"))
+		{
+			options.recover = true;
+		}
+		else if (!strcmp(argv[i], "--profile"))
+		{
+			options.profile = true;
+		}
+		else if (!strcmp(argv[i], "--layout"))
+		{
+			++i;
+			if (i < argc && !strcmp(argv[i], "bfs"))
+			{
+				layout = Layout_BFS;
+			}
+			else if (i < argc && !strcmp(argv[i], "hot"))
+			{
+				layout = Layout_Hot;
+			}
+			else
+			{
+				PrintUsage();
+				return -1;
+			}
+		}
+		else if (!strcmp(argv[i], "--train"))
+		{
+			++i;
+			if (i == argc)
+			{
+				PrintUsage();
+				return -1;
+			}
+			trainPath = argv[i];
+		}
+		else if (!strcmp(argv[i], "--profile-data"))
+		{
+			++i;
+			if (i == argc)
+			{
+				PrintUsage();
+				return -1;
+			}
+			profileDataPath = argv[i];
+		}
+		else if (!strcmp(argv[i], "--cache"))
+		{
+			++i;
+			if (i == argc)
+			{
+				PrintUsage();
+				return -1;
+			}
+			cacheDirectory = argv[i];
+		}
+		else if (!strcmp(argv[i], "--stats"))
+		{
+			stats = true;
+		}
+		else if (!strcmp(argv[i], "--stats-json"))
+		{
+			statsJson = true;
+		}
 		else
 		{
 			inputPath = argv[i];
 		}
 	}
 	
-	if (!inputPath || !outputHeaderPath || !outputSourcePath)
+	if (!inputPath || (!outputCppPath && (!outputHeaderPath || !outputSourcePath)))
 	{
 		PrintUsage();
 		return -1;
 	}
+	/* The C++ header only has the table scanner; the other scanners and the profiling build are C only */
+	bool cOnly = (options.push || options.stream || options.mmap || options.parallel || options.many || options.stride2 || options.incremental || options.sync || options.lines || options.recover || options.profile);
+	if (!outputHeaderPath && cOnly)
+	{
+		PrintUsage();
+		return -1;
+	}
+	if (trainPath || profileDataPath)
+	{
+		layout = Layout_Hot;
+	}
+	if (layout == Layout_Hot && !trainPath && !profileDataPath)
+	{
+		fprintf(stderr, "clex: --layout hot needs --train or --profile-data\n");
+		return -1;
+	}
+	
+	Stats statistics;
+	memset(&statistics, 0, sizeof(Stats));
+	double phaseBegin = GetSeconds();
+	
+	/* The grammar hash covers the grammar and every option that shapes the output, but no file names. Options are
+	 * hashed as parsed, in a fixed order, so that the order they were given in does not change it */
+	size_t grammarSize;
+	char *grammar = ReadFile(inputPath, &grammarSize);
+	if (!grammar)
+	{
+		fprintf(stderr, "clex: could not open %s\n", inputPath);
+		return -1;
+	}
+	options.grammarHash = HashBytes(0xCBF29CE484222325ull, grammar, grammarSize);
+	free(grammar);
+	uint64_t shape[] =
+	{
+		options.push, options.stream, options.mmap, options.parallel, options.many, options.stride2, (options.stride2 ? options.stride2Limit : 0),
+		options.incremental, options.sync, options.lines, options.recover, options.profile, layout
+	};
+	options.grammarHash = HashBytes(options.grammarHash, shape, sizeof(shape));
+	const char *dataPaths[] = {trainPath, profileDataPath};
+	for (size_t i = 0; i < sizeof(dataPaths) / sizeof(dataPaths[0]); ++i)
+	{
+		size_t dataSize = 0;
+		char *data = (dataPaths[i] ? ReadFile(dataPaths[i], &dataSize) : NULL);
+		uint64_t given = (dataPaths[i] != NULL);
+		options.grammarHash = HashBytes(options.grammarHash, &given, sizeof(uint64_t));
+		if (data)
+		{
+			options.grammarHash = HashBytes(options.grammarHash, data, dataSize);
+			free(data);
+		}
+	}
 	
 	InputRule *inputRules = NULL;
 	size_t inputRulesSize = 0;
-	ParseInputRules(inputPath, &inputRules, &inputRulesSize);
+	char **modes = NULL;
+	size_t modesSize = 0;
+	if (!ParseInputRules(inputPath, &inputRules, &inputRulesSize, &modes, &modesSize))
+	{
+		return -1;
+	}
+	
+	/* Keyword rules stay out of the DFA; tokens of their base rule are reclassified instead */
+	CodegenKeyword *keywords = malloc(inputRulesSize * sizeof(CodegenKeyword));
+	size_t keywordsSize = 0;
+	for (size_t i = 0; i < inputRulesSize; ++i)
+	{
+		const InputRule *rule = &inputRules[i];
+		if (!rule->keywordBase)
+		{
+			continue;
+		}
+		
+		bool baseFound = false;
+		for (size_t j = 0; j < inputRulesSize && !baseFound; ++j)
+		{
+			baseFound = (!inputRules[j].keywordBase && !strcmp(inputRules[j].symbol, rule->keywordBase));
+		}
+		if (!baseFound)
+		{
+			fprintf(stderr, "clex: keyword rule %s has no base rule %s\n", rule->symbol, rule->keywordBase);
+			return -1;
+		}
+		CodegenKeyword *keyword = &keywords[keywordsSize];
+		keyword->text = ParseKeywordText(rule->regex, &keyword->size);
+		if (!keyword->text || keyword->size > 0xFF)
+		{
+			fprintf(stderr, "clex: keyword rule %s must match a plain string of at most 255 bytes\n", rule->symbol);
+			return -1;
+		}
+		keyword->symbol = rule->symbol;
+		keyword->base = rule->keywordBase;
+		++keywordsSize;
+	}
+	
+	double phaseEnd = GetSeconds();
+	statistics.seconds[StatsPhase_Parse] = phaseEnd - phaseBegin;
+	phaseBegin = phaseEnd;
 	
 	/* Generate DFA */
 	NFA nfa;
 	NFA_Create(&nfa);
 	
 	DFAEntry *entries = malloc(inputRulesSize * sizeof(DFAEntry));
+	CodegenSymbol *symbols = malloc(inputRulesSize * sizeof(CodegenSymbol));
+	size_t entriesSize = 0;
 	for (size_t i = 0; i < inputRulesSize; ++i)
 	{
-		entries[i].symbol = inputRules[i].symbol;
-		NFA_ParseRegex(&nfa, inputRules[i].regex, &entries[i].expression);
+		symbols[i].name = inputRules[i].symbol;
+		symbols[i].value = inputRules[i].value;
+		symbols[i].intern = inputRules[i].intern;
+		symbols[i].groupsBegin = nfa.groups.size;
+		if (!inputRules[i].keywordBase)
+		{
+			entries[entriesSize].symbol = inputRules[i].symbol;
+			entries[entriesSize].modes = inputRules[i].modes;
+			NFA_ParseRegex(&nfa, inputRules[i].regex, &entries[entriesSize].expression);
+			
+			/* Every group has a begin and an end tag */
+			entries[entriesSize].tags = 0;
+			for (size_t tag = symbols[i].groupsBegin * 2; tag < nfa.groups.size * 2 && tag < DFA_TAGS_MAX; ++tag)
+			{
+				entries[entriesSize].tags |= (size_t)1 << tag;
+			}
+			++entriesSize;
+		}
+		symbols[i].groupsSize = nfa.groups.size - symbols[i].groupsBegin;
 	}
+	if (nfa.groups.size * 2 > DFA_TAGS_MAX)
+	{
+		fprintf(stderr, "clex: the grammar has %zu groups; at most %zu are supported\n", nfa.groups.size, DFA_TAGS_MAX / 2);
+		return -1;
+	}
+	
+	phaseEnd = GetSeconds();
+	statistics.seconds[StatsPhase_NFA] = phaseEnd - phaseBegin;
+	phaseBegin = phaseEnd;
 	
+	/* With a cache, an unchanged rule set skips subset construction and minimization */
 	DFA dfa;
 	DFA_Create(&dfa);
-	DFAState *start = DFA_FromEntries(&dfa, entries, inputRulesSize);
-	start = DFA_Minimize(&dfa, start);
-
-	/* Write header */
-	FILE *outputHeader;
-	fopen_s(&outputHeader, outputHeaderPath, "wb");
-	const char **symbols = malloc(inputRulesSize * sizeof(const char *));
-	for (size_t i = 0; i < inputRulesSize; ++i)
+	DFAState **starts = malloc(modesSize * sizeof(DFAState *));
+	char *cachePath = (cacheDirectory ? GetCachePath(cacheDirectory, inputRules, inputRulesSize, modesSize) : NULL);
+	statistics.cached = (cachePath && LoadCache(cachePath, &dfa, starts, modesSize, entries, entriesSize));
+	if (statistics.cached)
+	{
+		statistics.dfaStates = dfa.states.size;
+		statistics.dfaPeak = dfa.allocator.peak;
+		phaseEnd = GetSeconds();
+		statistics.seconds[StatsPhase_Construct] = phaseEnd - phaseBegin;
+	}
+	else
+	{
+		DFA_FromEntries(&dfa, entries, entriesSize, starts, modesSize);
+		statistics.dfaStates = dfa.states.size;
+		statistics.dfaPeak = dfa.allocator.peak;
+		phaseEnd = GetSeconds();
+		statistics.seconds[StatsPhase_Construct] = phaseEnd - phaseBegin;
+		phaseBegin = phaseEnd;
+		
+		DFA_Minimize(&dfa, starts, modesSize);
+		phaseEnd = GetSeconds();
+		statistics.seconds[StatsPhase_Minimize] = phaseEnd - phaseBegin;
+		
+		if (cachePath)
+		{
+			SaveCache(cacheDirectory, cachePath, &dfa, starts, modesSize, entries, entriesSize);
+		}
+	}
+	free(cachePath);
+	
+	/* A tag has a single register, so every path that ends a token must agree on where it is */
+	for (size_t i = 0; i < dfa.states.size; ++i)
+	{
+		const DFAState *state = DFAStateVector_Get(&dfa.states, i);
+		for (size_t tag = 0; tag < DFA_TAGS_MAX && state->tagsAmbiguous; ++tag)
+		{
+			if (state->tagsAmbiguous & ((size_t)1 << tag))
+			{
+				fprintf(stderr, "clex: rule %s: the %s of group %s depends on how the token is matched\n", state->symbol, (tag % 2 ? "end" : "beginning"), (const char *)Vector_Get(&nfa.groups, tag / 2));
+				return -1;
+			}
+		}
+	}
+	
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		bool matches = false;
+		for (size_t j = 0; j < modesSize && !matches; ++j)
+		{
+			matches = MatchesKeyword(starts[j], &keywords[i]);
+		}
+		if (!matches)
+		{
+			fprintf(stderr, "clex: warning: keyword rule %s does not scan as a single %s token\n", keywords[i].symbol, keywords[i].base);
+		}
+	}
+	
+	/* Hot states go first, so that the rows a scan spends its time in are contiguous; the rest stay breadth-first */
+	if (layout == Layout_Hot)
 	{
-		symbols[i] = inputRules[i].symbol;
+		size_t *weights = calloc(dfa.states.size, sizeof(size_t));
+		if (trainPath)
+		{
+			size_t trainSize;
+			char *train = ReadFile(trainPath, &trainSize);
+			if (!train)
+			{
+				fprintf(stderr, "clex: could not open %s\n", trainPath);
+				return -1;
+			}
+			DFA_CountTransitions(&dfa, starts[0], train, trainSize, weights);
+			free(train);
+		}
+		if (profileDataPath && !ReadProfileData(profileDataPath, &dfa, weights))
+		{
+			return -1;
+		}
+		DFA_Reorder(&dfa, starts, modesSize, weights);
+		free(weights);
 	}
-	Codegen_WriteHeader(outputHeader, symbols, inputRulesSize);
-	free((void *)symbols);
-	fclose(outputHeader);
 	
-	/* Write source */
-	FILE *outputSource;
-	fopen_s(&outputSource, outputSourcePath, "wb");
-	Codegen_WriteSource(outputSource, &dfa, start, outputHeaderPath);
-	fclose(outputSource);
+	/* Write header and source */
+	phaseBegin = GetSeconds();
+	bool written = true;
+	if (outputHeaderPath)
+	{
+		char *outputHeaderTemporaryPath = GetTemporaryPath(outputHeaderPath);
+		FILE *outputHeader;
+		if (fopen_s(&outputHeader, outputHeaderTemporaryPath, "wb") || !outputHeader)
+		{
+			fprintf(stderr, "clex: could not write %s\n", outputHeaderPath);
+			return -1;
+		}
+		Codegen_WriteHeader(outputHeader, &options, symbols, inputRulesSize, (const char **)nfa.groups.data, (const char **)modes, modesSize, keywords, keywordsSize);
+		fclose(outputHeader);
+		
+		char *outputSourceTemporaryPath = GetTemporaryPath(outputSourcePath);
+		FILE *outputSource;
+		if (fopen_s(&outputSource, outputSourceTemporaryPath, "wb") || !outputSource)
+		{
+			fprintf(stderr, "clex: could not write %s\n", outputSourcePath);
+			remove(outputHeaderTemporaryPath);
+			return -1;
+		}
+		written = Codegen_WriteSource(outputSource, &options, &dfa, starts, modesSize, symbols, inputRulesSize, keywords, keywordsSize, outputHeaderPath);
+		fclose(outputSource);
+		if (written)
+		{
+			written = ReplaceIfChanged(outputHeaderTemporaryPath, outputHeaderPath) && ReplaceIfChanged(outputSourceTemporaryPath, outputSourcePath);
+		}
+		else
+		{
+			/* Keep the outputs of the last successful run */
+			fprintf(stderr, "clex: could not build a perfect hash for the keyword rules\n");
+			remove(outputHeaderTemporaryPath);
+			remove(outputSourceTemporaryPath);
+		}
+		free(outputHeaderTemporaryPath);
+		free(outputSourceTemporaryPath);
+	}
+	
+	/* Write C++ header */
+	if (outputCppPath)
+	{
+		char *outputCppTemporaryPath = GetTemporaryPath(outputCppPath);
+		FILE *outputCpp;
+		if (fopen_s(&outputCpp, outputCppTemporaryPath, "wb") || !outputCpp)
+		{
+			fprintf(stderr, "clex: could not write %s\n", outputCppPath);
+			return -1;
+		}
+		bool cppWritten = Codegen_WriteCpp(outputCpp, &options, &dfa, starts, modesSize, symbols, inputRulesSize, (const char **)modes, keywords, keywordsSize);
+		fclose(outputCpp);
+		if (cppWritten)
+		{
+			written = ReplaceIfChanged(outputCppTemporaryPath, outputCppPath) && written;
+		}
+		else
+		{
+			if (!outputHeaderPath)
+			{
+				fprintf(stderr, "clex: could not build a perfect hash for the keyword rules\n");
+			}
+			remove(outputCppTemporaryPath);
+			written = false;
+		}
+		free(outputCppTemporaryPath);
+	}
+	statistics.seconds[StatsPhase_Codegen] = GetSeconds() - phaseBegin;
+	
+	if (stats || statsJson)
+	{
+		unsigned char classes[DFASTATE_EDGES_MAX];
+		statistics.nfaStates = nfa.allocator.size / sizeof(NFAState);
+		statistics.minimizedStates = dfa.states.size;
+		statistics.classes = DFA_ComputeByteClasses(&dfa, classes);
+		statistics.tableSize = Codegen_GetTableSize(&options, &dfa);
+		statistics.nfaPeak = nfa.allocator.peak;
+		statistics.keysPeak = dfa.keysPeak;
+		statistics.minimizedPeak = dfa.minimizedPeak;
+		StackAllocatorStats allocatorStats;
+		StackAllocator_GetStats(&allocatorStats);
+		statistics.blocksAllocated = allocatorStats.blocksAllocated;
+		statistics.blocksReused = allocatorStats.blocksReused;
+		PrintStats(&statistics, statsJson);
+	}
 	
 	/* Clean up */
 	DFA_Destroy(&dfa);
 	NFA_Destroy(&nfa);
+	free(starts);
 	free(entries);
+	free(symbols);
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		free((void *)keywords[i].text);
+	}
+	free(keywords);
 	for (size_t i = 0; i < inputRulesSize; ++i)
 	{
 		free((void *)inputRules[i].symbol);
 		free((void *)inputRules[i].regex);
+		free((void *)inputRules[i].keywordBase);
 	}
 	free(inputRules);
+	for (size_t i = 0; i < modesSize; ++i)
+	{
+		free(modes[i]);
+	}
+	free(modes);
+	StackAllocator_ReleaseFreeBlocks();
 	
-	return 0;
+	return (written ? 0 : -1);
 }
\ No newline at end of file
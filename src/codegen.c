@@ -2,40 +2,2787 @@
 
 #include "hash_table.h"
 
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-void Codegen_WriteHeader(FILE *output, const char **symbols, size_t symbolsSize)
+#define CODEGEN_KEYWORD_POSITIONS_MAX 5
+#define CODEGEN_KEYWORD_SEED_ATTEMPTS (1 << 20)
+
+VECTOR_DECLARE(CodegenIndexVector, size_t, 64)
+
+static bool Codegen_UsesBool(const CodegenOptions *options)
+{
+	return options->stream || options->mmap || options->parallel || options->many || options->incremental || options->sync || options->lines;
+}
+static bool Codegen_UsesTransition(const CodegenOptions *options)
+{
+	return options->push || options->stream || options->mmap || options->parallel || options->many || options->incremental || options->sync || options->lines;
+}
+static bool Codegen_HasValues(const CodegenSymbol *symbols, size_t symbolsSize)
+{
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		if (symbols[i].value != CodegenValue_None)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+static bool Codegen_HasIntern(const CodegenSymbol *symbols, size_t symbolsSize)
+{
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		if (symbols[i].intern)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+static bool Codegen_HasTags(const CodegenSymbol *symbols, size_t symbolsSize)
+{
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		if (symbols[i].groupsSize)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+static void Codegen_WritePushHeader(FILE *output, size_t keywordSizeMax, bool modes)
+{
+	const char *pushDeclaration = "\n\
+\n\
+/* Push mode: bytes are fed in arbitrary fragments and every finished token is\n\
+ * reported to emit with its type and length. CLex_Feed returns the number of\n\
+ * bytes consumed, which is less than size only if a token was rejected. */\n\
+typedef struct CLexContext CLexContext;\n\
+struct CLexContext\n\
+{\n\
+	size_t state;\n\
+	size_t size;\n";
+	fputs(pushDeclaration, output);
+	if (keywordSizeMax)
+	{
+		/* Keywords are classified after the token ends, which may be in a later fragment */
+		fprintf(output, "\tchar keyword[%zu];\n", keywordSizeMax);
+	}
+	if (modes)
+	{
+		/* Read whenever a token starts, so emit may switch modes between tokens */
+		fprintf(output, "\tCLexMode mode;\n");
+	}
+	
+	const char *pushFunctions = "};\n\
+\n\
+typedef void (*CLexEmitFunc)(void *user, TokenType type, size_t size);\n\
+\n\
+void CLex_Begin(CLexContext *context);\n\
+size_t CLex_Feed(CLexContext *context, const char *data, size_t size, CLexEmitFunc emit, void *user);\n\
+void CLex_End(CLexContext *context, CLexEmitFunc emit, void *user);";
+	fputs(pushFunctions, output);
+}
+static void Codegen_WriteLinesHeader(FILE *output)
+{
+	const char *linesDeclaration = "\n\
+\n\
+/* Line tracking: positions are 1-based, and columns count bytes. CLex_TokenizeLines\n\
+ * scans input[0, size) like CLex_Tokenize and also reports where every token starts\n\
+ * and how many newlines it contains, which is the line delta to the next token.\n\
+ * CLexReader keeps the position of the token it returned last and of the next one;\n\
+ * there, newlines are counted 16 bytes at a time and only in tokens of rules that\n\
+ * can match one. */\n\
+typedef struct CLexPosition CLexPosition;\n\
+struct CLexPosition\n\
+{\n\
+	size_t line;\n\
+	size_t column;\n\
+};\n\
+\n\
+typedef void (*CLexLineTokenFunc)(void *user, TokenType type, const char *token, size_t size, CLexPosition position, size_t lines);\n\
+\n\
+void CLex_TokenizeLines(const char *input, size_t size, CLexLineTokenFunc emit, void *user);";
+	fputs(linesDeclaration, output);
+}
+static void Codegen_WriteStreamHeader(FILE *output, bool modes, bool lines)
+{
+	const char *streamDeclaration = "\n\
+\n\
+/* Pull mode: the scanner runs over a caller-provided window of bufferSize bytes,\n\
+ * one of which holds a NUL sentinel. When a scan reaches the sentinel, the partial\n\
+ * token is moved to the front of the window and refill is asked for more input;\n\
+ * refill returns 0 at the end of input. A token returned by CLexReader_Next stays\n\
+ * valid until the next call, and tokens longer than the window are rejected.\n\
+ * After the last token, CLexReader_Next returns TokenType_CLex_Reject and\n\
+ * CLexReader_AtEnd returns true. */\n\
+typedef size_t (*CLexRefillFunc)(void *user, char *buffer, size_t size);\n\
+\n\
+typedef struct CLexReader CLexReader;\n\
+struct CLexReader\n\
+{\n\
+	char *buffer;\n\
+	size_t capacity;\n\
+	char *cursor;\n\
+	char *limit;\n\
+	bool end;\n\
+	CLexRefillFunc refill;\n\
+	void *user;\n";
+	fputs(streamDeclaration, output);
+	if (modes)
+	{
+		fprintf(output, "\tCLexMode mode;\n");
+	}
+	if (lines)
+	{
+		/* Where the token last returned starts, and where the one after it starts */
+		fprintf(output, "\tCLexPosition position;\n\tCLexPosition next;\n");
+	}
+	
+	const char *streamFunctions = "};\n\
+\n\
+void CLexReader_Create(CLexReader *reader, char *buffer, size_t bufferSize, CLexRefillFunc refill, void *user);\n\
+TokenType CLexReader_Next(CLexReader *reader, const char **token, size_t *size);\n\
+bool CLexReader_AtEnd(const CLexReader *reader);";
+	fputs(streamFunctions, output);
+}
+static void Codegen_WriteMmapHeader(FILE *output)
+{
+	const char *mmapDeclaration = "\n\
+\n\
+/* Maps the file at path read-only and reports every token to emit without copying\n\
+ * the file. Scanning ends at the first NUL byte or rejected token. Returns false if\n\
+ * the file could not be opened or mapped. */\n\
+bool CLex_TokenizeFile(const char *path, CLexTokenFunc emit, void *user);";
+	fputs(mmapDeclaration, output);
+}
+static void Codegen_WriteParallelHeader(FILE *output)
+{
+	const char *parallelDeclaration = "\n\
+\n\
+/* Batch mode: scans input[0, size) and reports every token to emit, ending after the\n\
+ * first rejected token. CLex_TokenizeParallel splits large inputs into chunks that\n\
+ * are scanned speculatively on threadCount threads, then reports exactly the same\n\
+ * tokens in the same order from the calling thread. */\n\
+void CLex_Tokenize(const char *input, size_t size, CLexTokenFunc emit, void *user);\n\
+void CLex_TokenizeParallel(const char *input, size_t size, size_t threadCount, CLexTokenFunc emit, void *user);";
+	fputs(parallelDeclaration, output);
+}
+static void Codegen_WriteManyHeader(FILE *output)
+{
+	const char *manyDeclaration = "\n\
+\n\
+/* Multi-stream mode: scans count independent inputs and keeps several of them in\n\
+ * flight at once, so that their table lookups overlap instead of waiting on each\n\
+ * other. This pays off once the state table no longer fits in the L1 cache. Each\n\
+ * input is scanned like CLex_Tokenize; tokens of one input are reported in order,\n\
+ * tokens of different inputs are interleaved. */\n\
+typedef void (*CLexStreamTokenFunc)(void *user, size_t stream, TokenType type, const char *token, size_t size);\n\
+\n\
+void CLex_TokenizeMany(const char *const *inputs, const size_t *sizes, size_t count, CLexStreamTokenFunc emit, void *user);";
+	fputs(manyDeclaration, output);
+}
+static void Codegen_WriteIncrementalHeader(FILE *output)
+{
+	const char *incrementalDeclaration = "\n\
+\n\
+/* Incremental mode: CLex_TokenizeList scans input[0, size) like CLex_Tokenize and\n\
+ * keeps every token in list. After an edit that replaced removed bytes at offset\n\
+ * with inserted bytes, CLex_Relex updates list for the edited input. It scans again\n\
+ * from the last token boundary before the edit only until the new tokens line up\n\
+ * with the old ones, and reuses the rest. The list is a gap buffer kept at the last\n\
+ * edit, so its tokens are read with CLexTokenList_Size and CLexTokenList_Get. Both\n\
+ * scanning functions return false if memory runs out; the list must then be rebuilt\n\
+ * with CLex_TokenizeList. */\n\
+typedef struct CLexToken CLexToken;\n\
+struct CLexToken\n\
+{\n\
+	TokenType type;\n\
+	size_t offset;\n\
+	size_t size;\n\
+};\n\
+\n\
+typedef struct CLexTokenList CLexTokenList;\n\
+struct CLexTokenList\n\
+{\n\
+	CLexToken *tokens;\n\
+	size_t capacity;\n\
+	size_t gapBegin;\n\
+	size_t gapEnd;\n\
+	size_t inputSize;\n\
+};\n\
+\n\
+void CLexTokenList_Create(CLexTokenList *list);\n\
+void CLexTokenList_Destroy(CLexTokenList *list);\n\
+size_t CLexTokenList_Size(const CLexTokenList *list);\n\
+CLexToken CLexTokenList_Get(const CLexTokenList *list, size_t index);\n\
+bool CLex_TokenizeList(CLexTokenList *list, const char *input, size_t size);\n\
+bool CLex_Relex(CLexTokenList *list, const char *input, size_t size, size_t offset, size_t removed, size_t inserted);";
+	fputs(incrementalDeclaration, output);
+}
+static void Codegen_WriteSyncHeader(FILE *output)
+{
+	const char *syncDeclaration = "\n\
+\n\
+/* Resynchronization: returns a token boundary at or after offset in input[0, size) that\n\
+ * a scan from the start of input produces too, without scanning from the start. The\n\
+ * scanner is run from every state it could be in CLEX_SYNC_WINDOW bytes before offset\n\
+ * until all of these runs agree on a token start. If they agree before offset, this is\n\
+ * the first boundary at or after offset. Returns size if they only agree at the end of\n\
+ * input, and (size_t)-1 if every run is rejected first. Runs that are rejected are\n\
+ * dropped, so the result is exact for input that scans without a rejected token. */\n\
+size_t CLex_SyncAt(const char *input, size_t size, size_t offset);";
+	fputs(syncDeclaration, output);
+}
+static void Codegen_WriteRecoverHeader(FILE *output, bool modes)
+{
+	const char *recoverDeclaration = "\n\
+\n\
+/* Error recovery: after CLex returns TokenType_CLex_Reject, skips *input ahead to the\n\
+ * next byte that can start a token, or to the terminating NUL, and returns the number\n\
+ * of bytes skipped. Together with the rejected token, they form one error span. */\n\
+size_t CLex_Recover(const char **input);";
+	fputs(recoverDeclaration, output);
+	if (modes)
+	{
+		const char *modeDeclaration = "\n\
+\n\
+/* CLex_Recover stops at bytes that start a token in CLexMode_Default, CLex_ModeRecover\n\
+ * at those that start one in mode. Recovering in the mode that rejected always skips at\n\
+ * least one byte when nothing was consumed. */\n\
+size_t CLex_ModeRecover(const char **input, CLexMode mode);";
+		fputs(modeDeclaration, output);
+	}
+}
+static void Codegen_WriteProfileHeader(FILE *output)
+{
+	const char *profileDeclaration = "\n\
+\n\
+#if defined(CLEX_PROFILE)\n\
+#include <stdio.h>\n\
+\n\
+/* Profiling build, compiled in when CLEX_PROFILE is defined: CLex counts the transitions\n\
+ * taken out of every state and the tokens and bytes of every type it returns, rejects\n\
+ * included. The counters are global and not atomic. CLex_DumpProfile writes them as one\n\
+ * \"rule name tokens bytes\" line per type and one \"state index transitions type\" line\n\
+ * per state that was left; CLex_ResetProfile clears them. Unless the scanner was\n\
+ * generated with --layout hot, clex --profile-data reads the dump back to put the hot\n\
+ * states first. */\n\
+void CLex_DumpProfile(FILE *output);\n\
+void CLex_ResetProfile(void);\n\
+#endif";
+	fputs(profileDeclaration, output);
+}
+static void Codegen_WriteModesHeader(FILE *output, const char **modes, size_t modesSize)
+{
+	fprintf(output, "\n\ntypedef enum CLexMode\n{\n\tCLexMode_%s", modes[0]);
+	for (size_t i = 1; i < modesSize; ++i)
+	{
+		fprintf(output, ",\n\tCLexMode_%s", modes[i]);
+	}
+	
+	const char *modesDeclaration = "\n\
+} CLexMode;\n\
+\n\
+/* Start conditions: every mode scans with its own rules, starting from its own\n\
+ * state in the shared table. CLex scans in CLexMode_Default. Push contexts and\n\
+ * readers scan in their mode field, which may be changed between tokens. All\n\
+ * other entry points scan in CLexMode_Default. */\n\
+TokenType CLex_Mode(const char **input, CLexMode mode);";
+	fputs(modesDeclaration, output);
+}
+static void Codegen_WriteValuesHeader(FILE *output, bool modes)
+{
+	const char *valuesDeclaration = "\n\
+\n\
+/* Value actions: tokens of rules declared with %value(kind) carry a value that is\n\
+ * computed while they are scanned. decimal and hex accumulate the token's digits and\n\
+ * skip other bytes, hash is the 64-bit FNV-1a hash of the token, and escapes counts\n\
+ * its backslash escapes. Other tokens have the value 0. */\n\
+TokenType CLex_Value(const char **input, uint64_t *value);";
+	fputs(valuesDeclaration, output);
+	if (modes)
+	{
+		fprintf(output, "\nTokenType CLex_ModeValue(const char **input, CLexMode mode, uint64_t *value);");
+	}
+}
+static void Codegen_WriteTagsHeader(FILE *output, const CodegenSymbol *symbols, size_t symbolsSize, const char **groups, bool modes)
+{
+	size_t tagsMax = 0;
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		if (symbols[i].groupsSize * 2 > tagsMax)
+		{
+			tagsMax = symbols[i].groupsSize * 2;
+		}
+	}
+	
+	const char *tagsDeclaration = "\n\
+\n\
+/* Submatch tags: rules may name groups with (?<name>...). CLex_Tags fills tags with\n\
+ * the offsets from the token start where each group of the returned token's rule\n\
+ * begins and ends, or (size_t)-1 for groups the token did not pass through. They\n\
+ * are recorded during the scan, so the token is not read a second time. */\n";
+	fputs(tagsDeclaration, output);
+	fprintf(output, "#define CLEX_TAGS_MAX %zu\n\nenum\n{", tagsMax);
+	bool first = true;
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		for (size_t j = 0; j < symbols[i].groupsSize; ++j)
+		{
+			const char *group = groups[symbols[i].groupsBegin + j];
+			fprintf(output, "%s\n\tCLexTag_%s_%sBegin = %zu,\n\tCLexTag_%s_%sEnd = %zu", (first ? "" : ","), symbols[i].name, group, j * 2, symbols[i].name, group, j * 2 + 1);
+			first = false;
+		}
+	}
+	fprintf(output, "\n};\n\nTokenType CLex_Tags(const char **input, size_t *tags);");
+	if (modes)
+	{
+		fprintf(output, "\nTokenType CLex_ModeTags(const char **input, CLexMode mode, size_t *tags);");
+	}
+}
+static void Codegen_WriteInternHeader(FILE *output, bool modes)
+{
+	const char *internDeclaration = "\n\
+\n\
+/* Interning: CLex_Intern hashes every token while scanning it, and adds tokens of\n\
+ * rules declared with %intern to pool, an open-addressing table of their distinct\n\
+ * texts. id is the text's index in the pool, or (size_t)-1 for other tokens and if\n\
+ * memory runs out. CLexPool_Get returns the NUL-terminated text, which stays valid\n\
+ * until the pool grows. */\n\
+typedef struct CLexPoolEntry CLexPoolEntry;\n\
+struct CLexPoolEntry\n\
+{\n\
+	uint64_t hash;\n\
+	size_t offset;\n\
+	size_t size;\n\
+};\n\
+\n\
+typedef struct CLexPool CLexPool;\n\
+struct CLexPool\n\
+{\n\
+	uint32_t *slots;\n\
+	size_t slotsCapacity;\n\
+	CLexPoolEntry *entries;\n\
+	size_t entriesSize;\n\
+	size_t entriesCapacity;\n\
+	char *text;\n\
+	size_t textSize;\n\
+	size_t textCapacity;\n\
+};\n\
+\n\
+void CLexPool_Create(CLexPool *pool);\n\
+void CLexPool_Destroy(CLexPool *pool);\n\
+size_t CLexPool_Size(const CLexPool *pool);\n\
+const char *CLexPool_Get(const CLexPool *pool, size_t id, size_t *size);\n\
+TokenType CLex_Intern(const char **input, CLexPool *pool, size_t *id);";
+	fputs(internDeclaration, output);
+	if (modes)
+	{
+		fprintf(output, "\nTokenType CLex_ModeIntern(const char **input, CLexMode mode, CLexPool *pool, size_t *id);");
+	}
+}
+void Codegen_WriteHeader(FILE *output, const CodegenOptions *options, const CodegenSymbol *symbols, size_t symbolsSize, const char **groups, const char **modes, size_t modesSize, const CodegenKeyword *keywords, size_t keywordsSize)
 {
-	fprintf(output, "/* Generated by CLex */\n\ntypedef enum TokenType\n{\n\tTokenType_CLex_Reject");
+	bool values = Codegen_HasValues(symbols, symbolsSize);
+	bool intern = Codegen_HasIntern(symbols, symbolsSize);
+	size_t keywordSizeMax = 0;
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		if (keywords[i].size > keywordSizeMax)
+		{
+			keywordSizeMax = keywords[i].size;
+		}
+	}
+	
+	fprintf(output, "/* Generated by CLex */\n\n");
+	if (options->grammarHash)
+	{
+		fprintf(output, "#define CLEX_GRAMMAR_HASH 0x%016llXull\n\n", (unsigned long long)options->grammarHash);
+	}
+	fprintf(output, "#include <stddef.h>\n");
+	if (Codegen_UsesBool(options))
+	{
+		fprintf(output, "#include <stdbool.h>\n");
+	}
+	if (values || intern)
+	{
+		fprintf(output, "#include <stdint.h>\n");
+	}
+	fprintf(output, "\ntypedef enum TokenType\n{\n\tTokenType_CLex_Reject");
 	for (size_t i = 0; i < symbolsSize; ++i)
 	{
-		fprintf(output, ",\n\tTokenType_%s", symbols[i]);
+		fprintf(output, ",\n\tTokenType_%s", symbols[i].name);
 	}
 	fprintf(output, "\n} TokenType;\n\nTokenType CLex(const char **input);");
+	
+	if (modesSize > 1)
+	{
+		Codegen_WriteModesHeader(output, modes, modesSize);
+	}
+	if (values)
+	{
+		Codegen_WriteValuesHeader(output, modesSize > 1);
+	}
+	if (Codegen_HasTags(symbols, symbolsSize))
+	{
+		Codegen_WriteTagsHeader(output, symbols, symbolsSize, groups, modesSize > 1);
+	}
+	if (intern)
+	{
+		Codegen_WriteInternHeader(output, modesSize > 1);
+	}
+	if (options->push)
+	{
+		Codegen_WritePushHeader(output, keywordSizeMax, modesSize > 1);
+	}
+	if (options->lines)
+	{
+		Codegen_WriteLinesHeader(output);
+	}
+	if (options->stream)
+	{
+		Codegen_WriteStreamHeader(output, modesSize > 1, options->lines);
+	}
+	if (options->mmap || options->parallel)
+	{
+		fprintf(output, "\n\ntypedef void (*CLexTokenFunc)(void *user, TokenType type, const char *token, size_t size);");
+	}
+	if (options->mmap)
+	{
+		Codegen_WriteMmapHeader(output);
+	}
+	if (options->parallel)
+	{
+		Codegen_WriteParallelHeader(output);
+	}
+	if (options->many)
+	{
+		Codegen_WriteManyHeader(output);
+	}
+	if (options->incremental)
+	{
+		Codegen_WriteIncrementalHeader(output);
+	}
+	if (options->sync)
+	{
+		Codegen_WriteSyncHeader(output);
+	}
+	if (options->recover)
+	{
+		Codegen_WriteRecoverHeader(output, modesSize > 1);
+	}
+	if (options->profile)
+	{
+		Codegen_WriteProfileHeader(output);
+	}
 }
 static void Codegen_WriteDFAState(FILE *output, const DFAState *state, HashTable *stateToIndex)
 {
 	fprintf(output, "\t{");
 	if (state->symbol)
 	{
-		fprintf(output, "TokenType_%s, {[0] = 0", state->symbol);
+		fprintf(output, "TokenType_%s, {[0] = 0", state->symbol);
+	}
+	else
+	{
+		fprintf(output, "TokenType_CLex_Reject, {[0] = 0");
+	}
+	
+	bool first = true;
+	for (int i = 0; i < DFASTATE_EDGES_MAX; ++i)
+	{
+		if (state->edges[i])
+		{
+			fprintf(output, ", [%i] = %zu", i, (size_t)*HashTable_Find(stateToIndex, state->edges[i]));
+			first = false;
+		}
+	}
+	
+	fprintf(output, "}}");
+}
+static void Codegen_WriteTransition(FILE *output)
+{
+	const char *transitionDefinition = "\n\
+\n\
+static size_t CLex_Transition(size_t state, unsigned char c)\n\
+{\n\
+	return (c < 128 ? k_states[state].edges[c] : 0);\n\
+}";
+	fputs(transitionDefinition, output);
+}
+static void Codegen_WritePush(FILE *output, bool keywords, bool modes)
+{
+	fprintf(output, "\n\nvoid CLex_Begin(CLexContext *context)\n{\n");
+	if (modes)
+	{
+		fprintf(output, "\tcontext->mode = CLexMode_Default;\n");
+	}
+	
+	const char *beginDefinition = "\
+	context->state = k_initialState;\n\
+	context->size = 0;\n\
+}\n\
+\n\
+size_t CLex_Feed(CLexContext *context, const char *data, size_t size, CLexEmitFunc emit, void *user)\n\
+{\n";
+	fputs(beginDefinition, output);
+	if (modes)
+	{
+		/* The mode may have changed since the last token ended */
+		fprintf(output, "\tsize_t tokenSize = context->size;\n\tsize_t state = (tokenSize ? context->state : k_initialStates[context->mode]);\n");
+	}
+	else
+	{
+		fprintf(output, "\tsize_t state = context->state;\n\tsize_t tokenSize = context->size;\n");
+	}
+	
+	const char *pushDefinition = "\
+	size_t i = 0;\n\
+	while (i < size)\n\
+	{\n\
+		size_t next = CLex_Transition(state, (unsigned char)data[i]);\n\
+		if (next)\n\
+		{\n";
+	fputs(pushDefinition, output);
+	if (keywords)
+	{
+		const char *keywordCapture = "\
+			if (tokenSize < sizeof(context->keyword))\n\
+			{\n\
+				context->keyword[tokenSize] = data[i];\n\
+			}\n";
+		fputs(keywordCapture, output);
+	}
+	
+	const char *pushTail = "\
+			state = next;\n\
+			++tokenSize;\n\
+			++i;\n\
+		}\n\
+		else\n\
+		{\n\
+			TokenType type = CLex_Classify(k_states[state].type, context->keyword, tokenSize);\n\
+			emit(user, type, tokenSize);\n";
+	fputs(pushTail, output);
+	fprintf(output, "\t\t\tstate = %s;\n", (modes ? "k_initialStates[context->mode]" : "k_initialState"));
+	
+	const char *feedTail = "\
+			tokenSize = 0;\n\
+			if (type == TokenType_CLex_Reject)\n\
+			{\n\
+				break;\n\
+			}\n\
+		}\n\
+	}\n\
+	context->state = state;\n\
+	context->size = tokenSize;\n\
+	return i;\n\
+}\n\
+\n\
+void CLex_End(CLexContext *context, CLexEmitFunc emit, void *user)\n\
+{\n\
+	if (context->size)\n\
+	{\n\
+		emit(user, CLex_Classify(k_states[context->state].type, context->keyword, context->size), context->size);\n\
+	}\n\
+	CLex_Begin(context);\n\
+}";
+	fputs(feedTail, output);
+}
+static void Codegen_WriteAdvance(FILE *output, const DFA *dfa, HashTable *stateToIndex, const CodegenSymbol *symbols, size_t symbolsSize)
+{
+	/* A token can only contain a newline if it ends in a state reachable through a '\n' edge */
+	bool *reached = calloc(dfa->states.size + 1, sizeof(bool));
+	CodegenIndexVector pending;
+	CodegenIndexVector_Create(&pending, NULL);
+	for (size_t i = 0; i < dfa->states.size; ++i)
+	{
+		const DFAState *target = DFAStateVector_Get(&dfa->states, i)->edges['\n'];
+		size_t index = (target ? (size_t)*HashTable_Find(stateToIndex, target) : 0);
+		if (index && !reached[index])
+		{
+			reached[index] = true;
+			CodegenIndexVector_Push(&pending, index);
+		}
+	}
+	while (pending.size)
+	{
+		const DFAState *state = DFAStateVector_Get(&dfa->states, CodegenIndexVector_Pop(&pending) - 1);
+		for (size_t c = 0; c < DFASTATE_EDGES_MAX; ++c)
+		{
+			size_t index = (state->edges[c] ? (size_t)*HashTable_Find(stateToIndex, state->edges[c]) : 0);
+			if (index && !reached[index])
+			{
+				reached[index] = true;
+				CodegenIndexVector_Push(&pending, index);
+			}
+		}
+	}
+	
+	fprintf(output, "\n\n/* Whether tokens of a type may span lines; the others only move the column */\nstatic const unsigned char k_multiline[] = {1");
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		bool multiline = false;
+		for (size_t j = 0; j < dfa->states.size && !multiline; ++j)
+		{
+			const DFAState *state = DFAStateVector_Get(&dfa->states, j);
+			multiline = (reached[j + 1] && state->symbol && !strcmp(state->symbol, symbols[i].name));
+		}
+		fprintf(output, ", %i", (multiline ? 1 : 0));
+	}
+	CodegenIndexVector_Destroy(&pending);
+	free(reached);
+	
+	const char *advanceDefinition = "};\n\
+\n\
+#if defined(CLEX_SSE2) && (defined(__GNUC__) || defined(__clang__))\n\
+#define CLEX_POPCOUNT16(mask) ((size_t)__builtin_popcount(mask))\n\
+#elif defined(CLEX_SSE2)\n\
+static size_t CLEX_POPCOUNT16(unsigned mask)\n\
+{\n\
+	mask = mask - ((mask >> 1) & 0x5555);\n\
+	mask = (mask & 0x3333) + ((mask >> 2) & 0x3333);\n\
+	mask = (mask + (mask >> 4)) & 0x0F0F;\n\
+	return (mask + (mask >> 8)) & 0x1F;\n\
+}\n\
+#endif\n\
+\n\
+/* Moves position past a token of the given (unclassified) type and returns the newlines in it */\n\
+static size_t CLex_Advance(CLexPosition *position, TokenType type, const char *token, size_t size)\n\
+{\n\
+	if (!k_multiline[type])\n\
+	{\n\
+		position->column += size;\n\
+		return 0;\n\
+	}\n\
+	\n\
+	size_t count = 0;\n\
+	size_t lineBegin = 0;\n\
+	size_t i = 0;\n\
+#if defined(CLEX_SSE2)\n\
+	const __m128i newline = _mm_set1_epi8('\\n');\n\
+	for (; i + 16 <= size; i += 16)\n\
+	{\n\
+		unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(token + i)), newline));\n\
+		if (mask)\n\
+		{\n\
+			count += CLEX_POPCOUNT16(mask);\n\
+			lineBegin = i;\n\
+		}\n\
+	}\n\
+#elif defined(CLEX_NEON)\n\
+	const uint8x16_t newline = vdupq_n_u8('\\n');\n\
+	for (; i + 16 <= size; i += 16)\n\
+	{\n\
+		size_t blockCount = vaddvq_u8(vshrq_n_u8(vceqq_u8(vld1q_u8((const uint8_t *)(token + i)), newline), 7));\n\
+		if (blockCount)\n\
+		{\n\
+			count += blockCount;\n\
+			lineBegin = i;\n\
+		}\n\
+	}\n\
+#endif\n\
+	/* Blocks only record where the last one with a newline starts; find the newline in it */\n\
+	for (size_t j = lineBegin; j < i; ++j)\n\
+	{\n\
+		if (token[j] == '\\n')\n\
+		{\n\
+			lineBegin = j + 1;\n\
+		}\n\
+	}\n\
+	for (; i < size; ++i)\n\
+	{\n\
+		bool isNewline = (token[i] == '\\n');\n\
+		count += isNewline;\n\
+		lineBegin = (isNewline ? i + 1 : lineBegin);\n\
+	}\n\
+	\n\
+	if (count)\n\
+	{\n\
+		position->line += count;\n\
+		position->column = 1 + (size - lineBegin);\n\
+	}\n\
+	else\n\
+	{\n\
+		position->column += size;\n\
+	}\n\
+	return count;\n\
+}";
+	fputs(advanceDefinition, output);
+}
+static void Codegen_WriteLines(FILE *output)
+{
+	const char *linesDefinition = "\n\
+\n\
+void CLex_TokenizeLines(const char *input, size_t size, CLexLineTokenFunc emit, void *user)\n\
+{\n\
+	/* The loop waits on its table loads, so counting newlines alongside them is close to free */\n\
+	size_t line = 1;\n\
+	size_t lineBegin = 0;\n\
+	CLexPosition start = {1, 1};\n\
+	size_t state = k_initialState;\n\
+	size_t begin = 0;\n\
+	for (size_t i = 0; i < size; ++i)\n\
+	{\n\
+		unsigned char c = (unsigned char)input[i];\n\
+		size_t next = CLex_Transition(state, c);\n\
+		if (!next)\n\
+		{\n\
+			TokenType type = k_states[state].type;\n\
+			emit(user, CLex_Classify(type, input + begin, i - begin), input + begin, i - begin, start, line - start.line);\n\
+			if (type == TokenType_CLex_Reject)\n\
+			{\n\
+				return;\n\
+			}\n\
+			begin = i;\n\
+			start.line = line;\n\
+			start.column = 1 + (i - lineBegin);\n\
+			next = CLex_Transition(k_initialState, c);\n\
+			if (!next)\n\
+			{\n\
+				emit(user, TokenType_CLex_Reject, input + i, 0, start, 0);\n\
+				return;\n\
+			}\n\
+		}\n\
+		bool isNewline = (c == '\\n');\n\
+		line += isNewline;\n\
+		lineBegin = (isNewline ? i + 1 : lineBegin);\n\
+		state = next;\n\
+	}\n\
+	if (begin < size)\n\
+	{\n\
+		TokenType type = k_states[state].type;\n\
+		emit(user, CLex_Classify(type, input + begin, size - begin), input + begin, size - begin, start, line - start.line);\n\
+	}\n\
+}";
+	fputs(linesDefinition, output);
+}
+static void Codegen_WriteStream(FILE *output, bool modes, bool lines)
+{
+	const char *createDefinition = "\n\
+\n\
+void CLexReader_Create(CLexReader *reader, char *buffer, size_t bufferSize, CLexRefillFunc refill, void *user)\n\
+{\n\
+	reader->buffer = buffer;\n\
+	reader->capacity = bufferSize - 1;\n\
+	reader->cursor = buffer;\n\
+	reader->limit = buffer;\n\
+	*reader->limit = 0;\n\
+	reader->end = false;\n\
+	reader->refill = refill;\n\
+	reader->user = user;\n";
+	fputs(createDefinition, output);
+	if (modes)
+	{
+		fprintf(output, "\treader->mode = CLexMode_Default;\n");
+	}
+	if (lines)
+	{
+		fprintf(output, "\treader->position.line = 1;\n\treader->position.column = 1;\n\treader->next = reader->position;\n");
+	}
+	
+	const char *nextDefinition = "}\n\
+\n\
+TokenType CLexReader_Next(CLexReader *reader, const char **token, size_t *size)\n\
+{\n\
+	char *begin = reader->cursor;\n\
+	char *cursor = begin;\n";
+	fputs(nextDefinition, output);
+	fprintf(output, "\tsize_t lastState = %s;\n", (modes ? "k_initialStates[reader->mode]" : "k_initialState"));
+	
+	const char *streamDefinition = "\
+	for (;;)\n\
+	{\n\
+		/* Every state rejects NUL, so the sentinel ends this loop without a bounds check */\n\
+		size_t state = CLex_Transition(lastState, (unsigned char)*cursor);\n\
+		while (state)\n\
+		{\n\
+			++cursor;\n\
+			lastState = state;\n\
+			state = CLex_Transition(lastState, (unsigned char)*cursor);\n\
+		}\n\
+		if (cursor != reader->limit || reader->end)\n\
+		{\n\
+			break;\n\
+		}\n\
+		\n\
+		/* Reached the sentinel: move the partial token to the front of the window and refill */\n\
+		size_t kept = (size_t)(cursor - begin);\n\
+		if (kept == reader->capacity)\n\
+		{\n\
+			lastState = 0;\n\
+			break;\n\
+		}\n\
+		memmove(reader->buffer, begin, kept);\n\
+		begin = reader->buffer;\n\
+		cursor = begin + kept;\n\
+		size_t read = reader->refill(reader->user, cursor, reader->capacity - kept);\n\
+		reader->end = (read == 0);\n\
+		reader->limit = cursor + read;\n\
+		*reader->limit = 0;\n\
+	}\n\
+	reader->cursor = cursor;\n\
+	*token = begin;\n\
+	*size = (size_t)(cursor - begin);\n";
+	fputs(streamDefinition, output);
+	if (lines)
+	{
+		fprintf(output, "\treader->position = reader->next;\n\tCLex_Advance(&reader->next, k_states[lastState].type, begin, *size);\n");
+	}
+	
+	const char *streamTail = "\
+	return CLex_Classify(k_states[lastState].type, begin, *size);\n\
+}\n\
+\n\
+bool CLexReader_AtEnd(const CLexReader *reader)\n\
+{\n\
+	return reader->end && reader->cursor == reader->limit;\n\
+}";
+	fputs(streamTail, output);
+}
+static void Codegen_WriteMmap(FILE *output)
+{
+	const char *mmapDefinition = "\n\
+\n\
+static void CLex_TokenizeMapping(const char *cursor, CLexTokenFunc emit, void *user)\n\
+{\n\
+	while (*cursor)\n\
+	{\n\
+		const char *begin = cursor;\n\
+		size_t lastState = k_initialState;\n\
+		size_t state = CLex_Transition(lastState, (unsigned char)*cursor);\n\
+		while (state)\n\
+		{\n\
+			++cursor;\n\
+			lastState = state;\n\
+			state = CLex_Transition(lastState, (unsigned char)*cursor);\n\
+		}\n\
+		TokenType type = k_states[lastState].type;\n\
+		emit(user, CLex_Classify(type, begin, (size_t)(cursor - begin)), begin, (size_t)(cursor - begin));\n\
+		if (type == TokenType_CLex_Reject)\n\
+		{\n\
+			break;\n\
+		}\n\
+	}\n\
+}\n\
+\n\
+#if defined(_WIN32)\n\
+bool CLex_TokenizeFile(const char *path, CLexTokenFunc emit, void *user)\n\
+{\n\
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);\n\
+	if (file == INVALID_HANDLE_VALUE)\n\
+	{\n\
+		return false;\n\
+	}\n\
+	\n\
+	LARGE_INTEGER fileSize;\n\
+	SYSTEM_INFO systemInfo;\n\
+	GetSystemInfo(&systemInfo);\n\
+	if (!GetFileSizeEx(file, &fileSize))\n\
+	{\n\
+		CloseHandle(file);\n\
+		return false;\n\
+	}\n\
+	\n\
+	size_t size = (size_t)fileSize.QuadPart;\n\
+	bool result = false;\n\
+	if (size % systemInfo.dwPageSize != 0)\n\
+	{\n\
+		/* The zero-filled tail of the last page terminates the scan */\n\
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);\n\
+		if (mapping)\n\
+		{\n\
+			const char *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);\n\
+			if (view)\n\
+			{\n\
+				CLex_TokenizeMapping(view, emit, user);\n\
+				UnmapViewOfFile(view);\n\
+				result = true;\n\
+			}\n\
+			CloseHandle(mapping);\n\
+		}\n\
+	}\n\
+	else\n\
+	{\n\
+		/* The file ends on a page boundary, so there is no room for a terminator in the view */\n\
+		char *buffer = malloc(size + 1);\n\
+		size_t offset = 0;\n\
+		while (buffer && offset < size)\n\
+		{\n\
+			DWORD read = 0;\n\
+			DWORD request = (size - offset > 0x40000000 ? 0x40000000 : (DWORD)(size - offset));\n\
+			if (!ReadFile(file, buffer + offset, request, &read, NULL) || read == 0)\n\
+			{\n\
+				break;\n\
+			}\n\
+			offset += read;\n\
+		}\n\
+		if (buffer && offset == size)\n\
+		{\n\
+			buffer[size] = 0;\n\
+			CLex_TokenizeMapping(buffer, emit, user);\n\
+			result = true;\n\
+		}\n\
+		free(buffer);\n\
+	}\n\
+	\n\
+	CloseHandle(file);\n\
+	return result;\n\
+}\n\
+#else\n\
+bool CLex_TokenizeFile(const char *path, CLexTokenFunc emit, void *user)\n\
+{\n\
+	int file = open(path, O_RDONLY);\n\
+	if (file < 0)\n\
+	{\n\
+		return false;\n\
+	}\n\
+	\n\
+	struct stat fileInfo;\n\
+	if (fstat(file, &fileInfo) != 0)\n\
+	{\n\
+		close(file);\n\
+		return false;\n\
+	}\n\
+	\n\
+	/* Reserve the file's pages plus one zero page, then map the file over the front.\n\
+	 * Everything past the end of the file reads as zero, which terminates the scan\n\
+	 * before it can leave the mapping. */\n\
+	size_t size = (size_t)fileInfo.st_size;\n\
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);\n\
+	size_t mappingSize = (size + pageSize - 1) / pageSize * pageSize + pageSize;\n\
+	char *mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);\n\
+	if (mapping == MAP_FAILED)\n\
+	{\n\
+		close(file);\n\
+		return false;\n\
+	}\n\
+	if (size && mmap(mapping, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, file, 0) == MAP_FAILED)\n\
+	{\n\
+		munmap(mapping, mappingSize);\n\
+		close(file);\n\
+		return false;\n\
+	}\n\
+	close(file);\n\
+	\n\
+	if (size)\n\
+	{\n\
+		madvise(mapping, size, MADV_SEQUENTIAL);\n\
+#if defined(MADV_HUGEPAGE)\n\
+		madvise(mapping, size, MADV_HUGEPAGE);\n\
+#endif\n\
+	}\n\
+	\n\
+	CLex_TokenizeMapping(mapping, emit, user);\n\
+	munmap(mapping, mappingSize);\n\
+	return true;\n\
+}\n\
+#endif";
+	fputs(mmapDefinition, output);
+}
+static void Codegen_WriteScan(FILE *output)
+{
+	const char *scanDefinition = "\n\
+\n\
+typedef struct CLexCursor CLexCursor;\n\
+struct CLexCursor\n\
+{\n\
+	size_t state;\n\
+	size_t begin;\n\
+};\n\
+\n\
+typedef void (*CLexRecordFunc)(void *user, TokenType type, size_t begin, size_t end);\n\
+\n\
+/* Scans input[offset, end) from cursor, recording every token that ends in the range.\n\
+ * Returns false if scanning stopped on a rejected token. */\n\
+static bool CLex_ScanRange(const char *input, size_t offset, size_t end, CLexCursor *cursor, CLexRecordFunc record, void *user)\n\
+{\n\
+	size_t state = cursor->state;\n\
+	size_t begin = cursor->begin;\n\
+	for (size_t i = offset; i < end; ++i)\n\
+	{\n\
+		unsigned char c = (unsigned char)input[i];\n\
+		size_t next = CLex_Transition(state, c);\n\
+		if (!next)\n\
+		{\n\
+			TokenType type = k_states[state].type;\n\
+			record(user, type, begin, i);\n\
+			if (type == TokenType_CLex_Reject)\n\
+			{\n\
+				return false;\n\
+			}\n\
+			begin = i;\n\
+			next = CLex_Transition(k_initialState, c);\n\
+			if (!next)\n\
+			{\n\
+				record(user, TokenType_CLex_Reject, i, i);\n\
+				return false;\n\
+			}\n\
+		}\n\
+		state = next;\n\
+	}\n\
+	cursor->state = state;\n\
+	cursor->begin = begin;\n\
+	return true;\n\
+}\n\
+\n\
+typedef struct CLexEmitter CLexEmitter;\n\
+struct CLexEmitter\n\
+{\n\
+	const char *input;\n\
+	CLexTokenFunc emit;\n\
+	void *user;\n\
+};\n\
+\n\
+static void CLex_EmitRecord(void *user, TokenType type, size_t begin, size_t end)\n\
+{\n\
+	CLexEmitter *emitter = user;\n\
+	emitter->emit(emitter->user, CLex_Classify(type, emitter->input + begin, end - begin), emitter->input + begin, end - begin);\n\
+}\n\
+\n\
+void CLex_Tokenize(const char *input, size_t size, CLexTokenFunc emit, void *user)\n\
+{\n\
+	CLexEmitter emitter = {input, emit, user};\n\
+	CLexCursor cursor = {k_initialState, 0};\n\
+	if (CLex_ScanRange(input, 0, size, &cursor, CLex_EmitRecord, &emitter) && cursor.begin < size)\n\
+	{\n\
+		emit(user, CLex_Classify(k_states[cursor.state].type, input + cursor.begin, size - cursor.begin), input + cursor.begin, size - cursor.begin);\n\
+	}\n\
+}";
+	fputs(scanDefinition, output);
+}
+static void Codegen_WriteEntryStates(FILE *output, const DFA *dfa, HashTable *stateToIndex)
+{
+	/* For every byte, the distinct states the scanner can be in right after consuming it */
+	bool *entered = malloc((dfa->states.size + 1) * sizeof(bool));
+	size_t offsets[DFASTATE_EDGES_MAX + 1];
+	size_t entryStatesMax = 1;
+	
+	fprintf(output, "\n\nstatic const size_t k_entryStates[] =\n{\n\t0");
+	offsets[0] = 0;
+	for (int c = 0; c < DFASTATE_EDGES_MAX; ++c)
+	{
+		memset(entered, 0, (dfa->states.size + 1) * sizeof(bool));
+		size_t count = 0;
+		for (size_t i = 0; i < dfa->states.size; ++i)
+		{
+			const DFAState *state = DFAStateVector_Get(&dfa->states, i);
+			if (state->edges[c])
+			{
+				size_t index = (size_t)*HashTable_Find(stateToIndex, state->edges[c]);
+				if (!entered[index])
+				{
+					entered[index] = true;
+					fprintf(output, ", %zu", index);
+					++count;
+				}
+			}
+		}
+		offsets[c + 1] = offsets[c] + count;
+		if (count > entryStatesMax)
+		{
+			entryStatesMax = count;
+		}
+	}
+	fprintf(output, "\n};\n\nstatic const size_t k_entryOffsets[] =\n{\n\t");
+	for (int c = 0; c <= DFASTATE_EDGES_MAX; ++c)
+	{
+		/* Skip the padding entry at the front of k_entryStates */
+		fprintf(output, (c == 0 ? "%zu" : ", %zu"), offsets[c] + 1);
+	}
+	fprintf(output, "\n};\n\n#define CLEX_ENTRY_STATES_MAX %zu", entryStatesMax);
+	
+	free(entered);
+}
+static void Codegen_WriteParallel(FILE *output)
+{
+	const char *parallelDefinition = "\n\
+\n\
+#if !defined(CLEX_PARALLEL_CHUNK_MIN)\n\
+#define CLEX_PARALLEL_CHUNK_MIN ((size_t)1 << 16)\n\
+#endif\n\
+#if !defined(CLEX_PARALLEL_CHUNK_MAX)\n\
+#define CLEX_PARALLEL_CHUNK_MAX ((size_t)1 << 23)\n\
+#endif\n\
+\n\
+/* Token start used for tokens that began before the chunk being scanned */\n\
+#define CLEX_INHERITED ((size_t)-1)\n\
+\n\
+typedef struct CLexChunkToken CLexChunkToken;\n\
+struct CLexChunkToken\n\
+{\n\
+	TokenType type;\n\
+	size_t begin;\n\
+	size_t end;\n\
+};\n\
+\n\
+typedef struct CLexChunk CLexChunk;\n\
+struct CLexChunk\n\
+{\n\
+	const char *input;\n\
+	size_t begin;\n\
+	size_t end;\n\
+	bool converged;\n\
+	bool stopped;\n\
+	size_t merge;\n\
+	CLexCursor exit;\n\
+	CLexChunkToken *tokens;\n\
+	size_t tokensSize;\n\
+	size_t tokensCapacity;\n\
+};\n\
+\n\
+static void CLex_RecordChunkToken(void *user, TokenType type, size_t begin, size_t end)\n\
+{\n\
+	CLexChunk *chunk = user;\n\
+	if (chunk->tokensSize == chunk->tokensCapacity)\n\
+	{\n\
+		chunk->tokensCapacity = (chunk->tokensCapacity ? chunk->tokensCapacity + chunk->tokensCapacity / 2 : 1024);\n\
+		chunk->tokens = realloc(chunk->tokens, chunk->tokensCapacity * sizeof(CLexChunkToken));\n\
+	}\n\
+	CLexChunkToken *token = &chunk->tokens[chunk->tokensSize++];\n\
+	token->type = type;\n\
+	token->begin = begin;\n\
+	token->end = end;\n\
+}\n\
+\n\
+/* Runs the scanner over the chunk from every state it could start in, dropping paths\n\
+ * that reject and merging paths that reach the same state with the same token start.\n\
+ * Once a single path is left, the tokens after that point do not depend on the true\n\
+ * start state and are recorded for CLex_ResolveChunk. */\n\
+static void CLex_SpeculateChunk(CLexChunk *chunk)\n\
+{\n\
+	size_t states[CLEX_ENTRY_STATES_MAX];\n\
+	size_t begins[CLEX_ENTRY_STATES_MAX];\n\
+	size_t count = 0;\n\
+	\n\
+	if (chunk->begin == 0)\n\
+	{\n\
+		states[0] = k_initialState;\n\
+		begins[0] = 0;\n\
+		count = 1;\n\
+	}\n\
+	else\n\
+	{\n\
+		unsigned char c = (unsigned char)chunk->input[chunk->begin - 1];\n\
+		if (c < 128)\n\
+		{\n\
+			for (size_t j = k_entryOffsets[c]; j < k_entryOffsets[c + 1]; ++j)\n\
+			{\n\
+				states[count] = k_entryStates[j];\n\
+				begins[count] = CLEX_INHERITED;\n\
+				++count;\n\
+			}\n\
+		}\n\
+	}\n\
+	\n\
+	chunk->converged = false;\n\
+	chunk->stopped = false;\n\
+	chunk->tokensSize = 0;\n\
+	\n\
+	size_t i = chunk->begin;\n\
+	while (count > 1 && i < chunk->end)\n\
+	{\n\
+		unsigned char c = (unsigned char)chunk->input[i];\n\
+		size_t live = 0;\n\
+		for (size_t j = 0; j < count; ++j)\n\
+		{\n\
+			size_t state = states[j];\n\
+			size_t begin = begins[j];\n\
+			size_t next = CLex_Transition(state, c);\n\
+			if (!next)\n\
+			{\n\
+				if (k_states[state].type == TokenType_CLex_Reject)\n\
+				{\n\
+					continue;\n\
+				}\n\
+				begin = i;\n\
+				next = CLex_Transition(k_initialState, c);\n\
+				if (!next)\n\
+				{\n\
+					continue;\n\
+				}\n\
+			}\n\
+			\n\
+			bool merged = false;\n\
+			for (size_t k = 0; k < live && !merged; ++k)\n\
+			{\n\
+				merged = (states[k] == next && begins[k] == begin);\n\
+			}\n\
+			if (!merged)\n\
+			{\n\
+				states[live] = next;\n\
+				begins[live] = begin;\n\
+				++live;\n\
+			}\n\
+		}\n\
+		count = live;\n\
+		++i;\n\
+	}\n\
+	\n\
+	if (count > 1)\n\
+	{\n\
+		return;\n\
+	}\n\
+	\n\
+	chunk->converged = true;\n\
+	chunk->merge = i;\n\
+	if (count == 0)\n\
+	{\n\
+		chunk->stopped = true;\n\
+		return;\n\
+	}\n\
+	\n\
+	CLexCursor cursor = {states[0], begins[0]};\n\
+	chunk->stopped = !CLex_ScanRange(chunk->input, i, chunk->end, &cursor, CLex_RecordChunkToken, chunk);\n\
+	chunk->exit = cursor;\n\
+}\n\
+\n\
+/* Replays the chunk from its true start state up to the merge point and then reports\n\
+ * the recorded tokens. Chunks that never converged are scanned sequentially. */\n\
+static bool CLex_ResolveChunk(const CLexChunk *chunk, CLexCursor *cursor, CLexTokenFunc emit, void *user)\n\
+{\n\
+	CLexEmitter emitter = {chunk->input, emit, user};\n\
+	if (!chunk->converged)\n\
+	{\n\
+		return CLex_ScanRange(chunk->input, chunk->begin, chunk->end, cursor, CLex_EmitRecord, &emitter);\n\
+	}\n\
+	\n\
+	if (!CLex_ScanRange(chunk->input, chunk->begin, chunk->merge, cursor, CLex_EmitRecord, &emitter))\n\
+	{\n\
+		return false;\n\
+	}\n\
+	\n\
+	size_t inherited = cursor->begin;\n\
+	for (size_t i = 0; i < chunk->tokensSize; ++i)\n\
+	{\n\
+		const CLexChunkToken *token = &chunk->tokens[i];\n\
+		size_t begin = (token->begin == CLEX_INHERITED ? inherited : token->begin);\n\
+		emit(user, CLex_Classify(token->type, chunk->input + begin, token->end - begin), chunk->input + begin, token->end - begin);\n\
+	}\n\
+	if (chunk->stopped)\n\
+	{\n\
+		return false;\n\
+	}\n\
+	\n\
+	cursor->state = chunk->exit.state;\n\
+	cursor->begin = (chunk->exit.begin == CLEX_INHERITED ? inherited : chunk->exit.begin);\n\
+	return true;\n\
+}\n\
+\n\
+#if defined(_WIN32)\n\
+typedef HANDLE CLexThread;\n\
+\n\
+static DWORD WINAPI CLex_ThreadMain(LPVOID data)\n\
+{\n\
+	CLex_SpeculateChunk(data);\n\
+	return 0;\n\
+}\n\
+\n\
+static bool CLex_StartThread(CLexThread *thread, CLexChunk *chunk)\n\
+{\n\
+	*thread = CreateThread(NULL, 0, CLex_ThreadMain, chunk, 0, NULL);\n\
+	return *thread != NULL;\n\
+}\n\
+\n\
+static void CLex_JoinThread(CLexThread thread)\n\
+{\n\
+	WaitForSingleObject(thread, INFINITE);\n\
+	CloseHandle(thread);\n\
+}\n\
+#else\n\
+typedef pthread_t CLexThread;\n\
+\n\
+static void *CLex_ThreadMain(void *data)\n\
+{\n\
+	CLex_SpeculateChunk(data);\n\
+	return NULL;\n\
+}\n\
+\n\
+static bool CLex_StartThread(CLexThread *thread, CLexChunk *chunk)\n\
+{\n\
+	return pthread_create(thread, NULL, CLex_ThreadMain, chunk) == 0;\n\
+}\n\
+\n\
+static void CLex_JoinThread(CLexThread thread)\n\
+{\n\
+	pthread_join(thread, NULL);\n\
+}\n\
+#endif\n\
+\n\
+void CLex_TokenizeParallel(const char *input, size_t size, size_t threadCount, CLexTokenFunc emit, void *user)\n\
+{\n\
+	size_t chunkSize = (threadCount ? size / threadCount : size);\n\
+	if (chunkSize < CLEX_PARALLEL_CHUNK_MIN)\n\
+	{\n\
+		chunkSize = CLEX_PARALLEL_CHUNK_MIN;\n\
+	}\n\
+	else if (chunkSize > CLEX_PARALLEL_CHUNK_MAX)\n\
+	{\n\
+		chunkSize = CLEX_PARALLEL_CHUNK_MAX;\n\
+	}\n\
+	\n\
+	if (threadCount < 2 || size <= chunkSize)\n\
+	{\n\
+		CLex_Tokenize(input, size, emit, user);\n\
+		return;\n\
+	}\n\
+	\n\
+	/* Two rounds of chunks: one being speculated on while the other is reported */\n\
+	CLexChunk *chunks = calloc(2 * threadCount, sizeof(CLexChunk));\n\
+	CLexThread *threads = malloc(threadCount * sizeof(CLexThread));\n\
+	bool *started = malloc(threadCount * sizeof(bool));\n\
+	CLexChunk *current = chunks;\n\
+	CLexChunk *previous = chunks + threadCount;\n\
+	size_t previousSize = 0;\n\
+	\n\
+	CLexCursor cursor = {k_initialState, 0};\n\
+	bool running = true;\n\
+	size_t offset = 0;\n\
+	do\n\
+	{\n\
+		size_t currentSize = 0;\n\
+		while (running && currentSize < threadCount && offset < size)\n\
+		{\n\
+			CLexChunk *chunk = &current[currentSize];\n\
+			chunk->input = input;\n\
+			chunk->begin = offset;\n\
+			chunk->end = (size - offset > chunkSize ? offset + chunkSize : size);\n\
+			offset = chunk->end;\n\
+			\n\
+			started[currentSize] = CLex_StartThread(&threads[currentSize], chunk);\n\
+			if (!started[currentSize])\n\
+			{\n\
+				CLex_SpeculateChunk(chunk);\n\
+			}\n\
+			++currentSize;\n\
+		}\n\
+		\n\
+		for (size_t i = 0; i < previousSize && running; ++i)\n\
+		{\n\
+			running = CLex_ResolveChunk(&previous[i], &cursor, emit, user);\n\
+		}\n\
+		\n\
+		for (size_t i = 0; i < currentSize; ++i)\n\
+		{\n\
+			if (started[i])\n\
+			{\n\
+				CLex_JoinThread(threads[i]);\n\
+			}\n\
+		}\n\
+		\n\
+		CLexChunk *temp = previous;\n\
+		previous = current;\n\
+		current = temp;\n\
+		previousSize = currentSize;\n\
+	} while (previousSize);\n\
+	\n\
+	if (running && cursor.begin < size)\n\
+	{\n\
+		emit(user, CLex_Classify(k_states[cursor.state].type, input + cursor.begin, size - cursor.begin), input + cursor.begin, size - cursor.begin);\n\
+	}\n\
+	\n\
+	for (size_t i = 0; i < 2 * threadCount; ++i)\n\
+	{\n\
+		free(chunks[i].tokens);\n\
+	}\n\
+	free(chunks);\n\
+	free(threads);\n\
+	free(started);\n\
+}";
+	fputs(parallelDefinition, output);
+}
+static void Codegen_WriteMany(FILE *output)
+{
+	const char *manyDefinition = "\n\
+\n\
+#if !defined(CLEX_MANY_LANES)\n\
+#define CLEX_MANY_LANES 8\n\
+#endif\n\
+\n\
+#if defined(_MSC_VER)\n\
+#define CLEX_PREFETCH(address) _mm_prefetch((const char *)(address), _MM_HINT_T0)\n\
+#elif defined(__GNUC__) || defined(__clang__)\n\
+#define CLEX_PREFETCH(address) __builtin_prefetch(address)\n\
+#else\n\
+#define CLEX_PREFETCH(address) ((void)0)\n\
+#endif\n\
+\n\
+typedef struct CLexLane CLexLane;\n\
+struct CLexLane\n\
+{\n\
+	size_t stream;\n\
+	const char *input;\n\
+	size_t end;\n\
+	size_t cursor;\n\
+	size_t begin;\n\
+	size_t state;\n\
+};\n\
+\n\
+static void CLex_StartLane(CLexLane *lane, size_t stream, const char *input, size_t size)\n\
+{\n\
+	lane->stream = stream;\n\
+	lane->input = input;\n\
+	lane->end = size;\n\
+	lane->cursor = 0;\n\
+	lane->begin = 0;\n\
+	lane->state = k_initialState;\n\
+}\n\
+\n\
+/* Advances the lane by one byte. Returns false once the lane has finished its input. */\n\
+static bool CLex_StepLane(CLexLane *lane, CLexStreamTokenFunc emit, void *user)\n\
+{\n\
+	if (lane->cursor == lane->end)\n\
+	{\n\
+		if (lane->begin < lane->end)\n\
+		{\n\
+			emit(user, lane->stream, CLex_Classify(k_states[lane->state].type, lane->input + lane->begin, lane->end - lane->begin), lane->input + lane->begin, lane->end - lane->begin);\n\
+		}\n\
+		return false;\n\
+	}\n\
+	\n\
+	unsigned char c = (unsigned char)lane->input[lane->cursor];\n\
+	size_t next = CLex_Transition(lane->state, c);\n\
+	if (!next)\n\
+	{\n\
+		TokenType type = k_states[lane->state].type;\n\
+		emit(user, lane->stream, CLex_Classify(type, lane->input + lane->begin, lane->cursor - lane->begin), lane->input + lane->begin, lane->cursor - lane->begin);\n\
+		if (type == TokenType_CLex_Reject)\n\
+		{\n\
+			return false;\n\
+		}\n\
+		lane->begin = lane->cursor;\n\
+		next = CLex_Transition(k_initialState, c);\n\
+		if (!next)\n\
+		{\n\
+			emit(user, lane->stream, TokenType_CLex_Reject, lane->input + lane->cursor, 0);\n\
+			return false;\n\
+		}\n\
+	}\n\
+	lane->state = next;\n\
+	++lane->cursor;\n\
+	\n\
+	/* Start loading this lane's next edge while the other lanes take their step */\n\
+	unsigned char lookahead = (lane->cursor < lane->end ? (unsigned char)lane->input[lane->cursor] : 0);\n\
+	CLEX_PREFETCH(&k_states[next].edges[lookahead & 127]);\n\
+	return true;\n\
+}\n\
+\n\
+void CLex_TokenizeMany(const char *const *inputs, const size_t *sizes, size_t count, CLexStreamTokenFunc emit, void *user)\n\
+{\n\
+	CLexLane lanes[CLEX_MANY_LANES];\n\
+	size_t lanesSize = 0;\n\
+	size_t nextStream = 0;\n\
+	while (lanesSize < CLEX_MANY_LANES && nextStream < count)\n\
+	{\n\
+		CLex_StartLane(&lanes[lanesSize], nextStream, inputs[nextStream], sizes[nextStream]);\n\
+		++lanesSize;\n\
+		++nextStream;\n\
+	}\n\
+	\n\
+	while (lanesSize)\n\
+	{\n\
+		/* Issue the edge loads of all lanes before acting on any of them */\n\
+		size_t next[CLEX_MANY_LANES];\n\
+		for (size_t i = 0; i < lanesSize; ++i)\n\
+		{\n\
+			const CLexLane *lane = &lanes[i];\n\
+			next[i] = (lane->cursor < lane->end ? CLex_Transition(lane->state, (unsigned char)lane->input[lane->cursor]) : 0);\n\
+		}\n\
+		\n\
+		size_t active = 0;\n\
+		for (size_t i = 0; i < lanesSize; ++i)\n\
+		{\n\
+			CLexLane *lane = &lanes[i];\n\
+			if (next[i])\n\
+			{\n\
+				lane->state = next[i];\n\
+				++lane->cursor;\n\
+			}\n\
+			else if (!CLex_StepLane(lane, emit, user))\n\
+			{\n\
+				if (nextStream == count)\n\
+				{\n\
+					continue;\n\
+				}\n\
+				CLex_StartLane(lane, nextStream, inputs[nextStream], sizes[nextStream]);\n\
+				++nextStream;\n\
+			}\n\
+			if (active != i)\n\
+			{\n\
+				lanes[active] = *lane;\n\
+			}\n\
+			++active;\n\
+		}\n\
+		lanesSize = active;\n\
+	}\n\
+}";
+	fputs(manyDefinition, output);
+}
+static void Codegen_WriteIncremental(FILE *output)
+{
+	const char *incrementalDefinition = "\n\
+\n\
+void CLexTokenList_Create(CLexTokenList *list)\n\
+{\n\
+	list->tokens = NULL;\n\
+	list->capacity = 0;\n\
+	list->gapBegin = 0;\n\
+	list->gapEnd = 0;\n\
+	list->inputSize = 0;\n\
+}\n\
+\n\
+void CLexTokenList_Destroy(CLexTokenList *list)\n\
+{\n\
+	free(list->tokens);\n\
+	CLexTokenList_Create(list);\n\
+}\n\
+\n\
+size_t CLexTokenList_Size(const CLexTokenList *list)\n\
+{\n\
+	return list->capacity - (list->gapEnd - list->gapBegin);\n\
+}\n\
+\n\
+/* Tokens after the gap store the distance from their start to the end of the input,\n\
+ * which an edit before them does not change */\n\
+CLexToken CLexTokenList_Get(const CLexTokenList *list, size_t index)\n\
+{\n\
+	if (index < list->gapBegin)\n\
+	{\n\
+		return list->tokens[index];\n\
+	}\n\
+	CLexToken token = list->tokens[index + (list->gapEnd - list->gapBegin)];\n\
+	token.offset = list->inputSize - token.offset;\n\
+	return token;\n\
+}\n\
+\n\
+static void CLex_MoveGap(CLexTokenList *list, size_t index)\n\
+{\n\
+	CLexToken *tokens = list->tokens;\n\
+	while (list->gapBegin > index)\n\
+	{\n\
+		CLexToken token = tokens[--list->gapBegin];\n\
+		token.offset = list->inputSize - token.offset;\n\
+		tokens[--list->gapEnd] = token;\n\
+	}\n\
+	while (list->gapBegin < index)\n\
+	{\n\
+		CLexToken token = tokens[list->gapEnd++];\n\
+		token.offset = list->inputSize - token.offset;\n\
+		tokens[list->gapBegin++] = token;\n\
+	}\n\
+}\n\
+\n\
+static bool CLex_PushToken(CLexTokenList *list, CLexToken token)\n\
+{\n\
+	if (list->gapBegin == list->gapEnd)\n\
+	{\n\
+		size_t tail = list->capacity - list->gapEnd;\n\
+		size_t newCapacity = (list->capacity ? list->capacity * 2 : 64);\n\
+		CLexToken *tokens = realloc(list->tokens, newCapacity * sizeof(CLexToken));\n\
+		if (!tokens)\n\
+		{\n\
+			return false;\n\
+		}\n\
+		memmove(tokens + newCapacity - tail, tokens + list->gapEnd, tail * sizeof(CLexToken));\n\
+		list->tokens = tokens;\n\
+		list->capacity = newCapacity;\n\
+		list->gapEnd = newCapacity - tail;\n\
+	}\n\
+	list->tokens[list->gapBegin++] = token;\n\
+	return true;\n\
+}\n\
+\n\
+/* Every token starts in k_initialState, so a token boundary is all the state a rescan needs */\n\
+static CLexToken CLex_ScanToken(const char *input, size_t size, size_t offset)\n\
+{\n\
+	size_t state = k_initialState;\n\
+	size_t end = offset;\n\
+	while (end < size)\n\
+	{\n\
+		size_t next = CLex_Transition(state, (unsigned char)input[end]);\n\
+		if (!next)\n\
+		{\n\
+			break;\n\
+		}\n\
+		state = next;\n\
+		++end;\n\
+	}\n\
+	CLexToken token = {(end != offset ? CLex_Classify(k_states[state].type, input + offset, end - offset) : TokenType_CLex_Reject), offset, end - offset};\n\
+	return token;\n\
+}\n\
+\n\
+bool CLex_TokenizeList(CLexTokenList *list, const char *input, size_t size)\n\
+{\n\
+	list->gapBegin = 0;\n\
+	list->gapEnd = list->capacity;\n\
+	list->inputSize = size;\n\
+	size_t offset = 0;\n\
+	while (offset < size)\n\
+	{\n\
+		CLexToken token = CLex_ScanToken(input, size, offset);\n\
+		if (!CLex_PushToken(list, token))\n\
+		{\n\
+			list->gapBegin = 0;\n\
+			return false;\n\
+		}\n\
+		if (token.type == TokenType_CLex_Reject)\n\
+		{\n\
+			break;\n\
+		}\n\
+		offset += token.size;\n\
+	}\n\
+	return true;\n\
+}\n\
+\n\
+bool CLex_Relex(CLexTokenList *list, const char *input, size_t size, size_t offset, size_t removed, size_t inserted)\n\
+{\n\
+	/* Tokens after the gap are kept as distances from the end of the input, so they\n\
+	 * need no shift by the size of the edit */\n\
+	(void)removed;\n\
+	size_t count = CLexTokenList_Size(list);\n\
+	\n\
+	/* A token ends where the byte after it has no transition, so the first token the\n\
+	 * edit can change is the first one that ends at or after offset */\n\
+	size_t first = 0;\n\
+	size_t last = count;\n\
+	while (first < last)\n\
+	{\n\
+		size_t middle = first + (last - first) / 2;\n\
+		CLexToken token = CLexTokenList_Get(list, middle);\n\
+		if (token.offset + token.size < offset)\n\
+		{\n\
+			first = middle + 1;\n\
+		}\n\
+		else\n\
+		{\n\
+			last = middle;\n\
+		}\n\
+	}\n\
+	size_t position = 0;\n\
+	if (first < count)\n\
+	{\n\
+		position = CLexTokenList_Get(list, first).offset;\n\
+	}\n\
+	else if (count)\n\
+	{\n\
+		CLexToken token = CLexTokenList_Get(list, count - 1);\n\
+		position = token.offset + token.size;\n\
+	}\n\
+	CLex_MoveGap(list, first);\n\
+	list->inputSize = size;\n\
+	if (first == count && count && list->tokens[count - 1].type == TokenType_CLex_Reject)\n\
+	{\n\
+		/* The old scan stopped on a rejected token before the edit */\n\
+		return true;\n\
+	}\n\
+	\n\
+	/* Scan until a new token starts past the edit where an old token started. From\n\
+	 * there on both scans see the same bytes, so the old tokens after the gap still\n\
+	 * hold; old tokens that start before that point are dropped from the gap. */\n\
+	for (;;)\n\
+	{\n\
+		if (position >= offset + inserted)\n\
+		{\n\
+			size_t distance = size - position;\n\
+			while (list->gapEnd < list->capacity && list->tokens[list->gapEnd].offset > distance)\n\
+			{\n\
+				++list->gapEnd;\n\
+			}\n\
+			if (list->gapEnd < list->capacity && list->tokens[list->gapEnd].offset == distance)\n\
+			{\n\
+				return true;\n\
+			}\n\
+		}\n\
+		if (position == size)\n\
+		{\n\
+			break;\n\
+		}\n\
+		CLexToken token = CLex_ScanToken(input, size, position);\n\
+		if (!CLex_PushToken(list, token))\n\
+		{\n\
+			return false;\n\
+		}\n\
+		if (token.type == TokenType_CLex_Reject)\n\
+		{\n\
+			break;\n\
+		}\n\
+		position += token.size;\n\
+	}\n\
+	list->gapEnd = list->capacity;\n\
+	return true;\n\
+}";
+	fputs(incrementalDefinition, output);
+}
+static void Codegen_WriteRecover(FILE *output, DFAState *const *starts, size_t startsSize)
+{
+	/* NUL stops the search too. Bytes from 128 on never start a token, so every stop has a
+	 * high nibble below 8, and each of these nibbles gets its own bit in the shuffle masks.
+	 * With modes, every mode gets its own stops, so that a byte that only starts a token in
+	 * another mode is skipped. */
+	bool stops[DFA_MODES_MAX][DFASTATE_EDGES_MAX] = {{false}};
+	unsigned char lowMasks[DFA_MODES_MAX][16] = {{0}};
+	for (size_t i = 0; i < startsSize; ++i)
+	{
+		for (size_t c = 0; c < DFASTATE_EDGES_MAX; ++c)
+		{
+			stops[i][c] = (c == 0 || starts[i]->edges[c] != NULL);
+			if (stops[i][c])
+			{
+				lowMasks[i][c & 0x0F] |= (unsigned char)(1 << (c >> 4));
+			}
+		}
+	}
+	
+	const char *format = (startsSize > 1 ? "{%i" : "%i");
+	fprintf(output, "\n\n#if !defined(CLEX_SSSE3)\nstatic const unsigned char k_recoverStops%s[256] = {", (startsSize > 1 ? "[]" : ""));
+	for (size_t i = 0; i < startsSize; ++i)
+	{
+		fputs((i ? ", " : ""), output);
+		for (size_t c = 0; c < DFASTATE_EDGES_MAX; ++c)
+		{
+			fprintf(output, (c ? ", %i" : format), (stops[i][c] ? 1 : 0));
+		}
+		fputs((startsSize > 1 ? "}" : ""), output);
+	}
+	format = (startsSize > 1 ? "{0x%02X" : "0x%02X");
+	fprintf(output, "};\n#else\nstatic const unsigned char k_recoverLowMasks%s[16] = {", (startsSize > 1 ? "[]" : ""));
+	for (size_t i = 0; i < startsSize; ++i)
+	{
+		fputs((i ? ", " : ""), output);
+		for (size_t c = 0; c < 16; ++c)
+		{
+			fprintf(output, (c ? ", 0x%02X" : format), lowMasks[i][c]);
+		}
+		fputs((startsSize > 1 ? "}" : ""), output);
+	}
+	
+	const char *findStopsDefinition = "};\n\
+static const unsigned char k_recoverHighMasks[16] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};\n\
+\n\
+#if defined(_MSC_VER)\n\
+static unsigned CLex_FirstBit(unsigned mask)\n\
+{\n\
+	unsigned long index;\n\
+	_BitScanForward(&index, mask);\n\
+	return (unsigned)index;\n\
+}\n\
+#else\n\
+#define CLex_FirstBit(mask) ((unsigned)__builtin_ctz(mask))\n\
+#endif\n\
+\n\
+/* Looks up both nibbles of every byte in the block at once; a byte is a stop if its\n\
+ * masks share a bit */\n\
+static unsigned CLex_FindStops(const unsigned char *block, const unsigned char *lowMasks)\n\
+{\n\
+	const __m128i nibble = _mm_set1_epi8(0x0F);\n\
+	__m128i bytes = _mm_load_si128((const __m128i *)block);\n\
+	__m128i low = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)lowMasks), _mm_and_si128(bytes, nibble));\n\
+	__m128i high = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)k_recoverHighMasks), _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));\n\
+	__m128i misses = _mm_cmpeq_epi8(_mm_and_si128(low, high), _mm_setzero_si128());\n\
+	return ~(unsigned)_mm_movemask_epi8(misses) & 0xFFFF;\n\
+}\n\
+#endif\n\
+\n";
+	fputs(findStopsDefinition, output);
+	
+	const char *index = "";
+	if (startsSize > 1)
+	{
+		fprintf(output, "size_t CLex_ModeRecover(const char **input, CLexMode mode)\n");
+		index = "[mode]";
+	}
+	else
+	{
+		fprintf(output, "size_t CLex_Recover(const char **input)\n");
+	}
+	
+	const char *recoverDefinition = "{\n\
+	const unsigned char *begin = (const unsigned char *)*input;\n\
+	const unsigned char *cursor = begin;\n\
+#if defined(CLEX_SSSE3)\n\
+	/* Aligned blocks never cross a page boundary, so reading past the NUL is safe */\n\
+	const unsigned char *block = (const unsigned char *)((uintptr_t)begin & ~(uintptr_t)15);\n\
+	unsigned found = CLex_FindStops(block, k_recoverLowMasks%s) & (0xFFFFu << (begin - block));\n\
+	while (!found)\n\
+	{\n\
+		block += 16;\n\
+		found = CLex_FindStops(block, k_recoverLowMasks%s);\n\
+	}\n\
+	cursor = block + CLex_FirstBit(found);\n\
+#else\n\
+	while (!k_recoverStops%s[*cursor])\n\
+	{\n\
+		++cursor;\n\
+	}\n\
+#endif\n\
+	*input = (const char *)cursor;\n\
+	return (size_t)(cursor - begin);\n\
+}";
+	fprintf(output, recoverDefinition, index, index, index);
+	if (startsSize > 1)
+	{
+		const char *defaultDefinition = "\n\
+\n\
+size_t CLex_Recover(const char **input)\n\
+{\n\
+	return CLex_ModeRecover(input, CLexMode_Default);\n\
+}";
+		fputs(defaultDefinition, output);
+	}
+}
+static void Codegen_WriteSync(FILE *output)
+{
+	const char *syncDefinition = "\n\
+\n\
+#if !defined(CLEX_SYNC_WINDOW)\n\
+#define CLEX_SYNC_WINDOW ((size_t)1 << 8)\n\
+#endif\n\
+\n\
+/* Token start used for tokens that began before offset, whose exact start does not matter */\n\
+#define CLEX_SYNC_UNKNOWN ((size_t)-1)\n\
+\n\
+size_t CLex_SyncAt(const char *input, size_t size, size_t offset)\n\
+{\n\
+	if (offset >= size)\n\
+	{\n\
+		return size;\n\
+	}\n\
+	\n\
+	size_t states[CLEX_ENTRY_STATES_MAX];\n\
+	size_t begins[CLEX_ENTRY_STATES_MAX];\n\
+	size_t count = 0;\n\
+	size_t i = (offset > CLEX_SYNC_WINDOW ? offset - CLEX_SYNC_WINDOW : 0);\n\
+	if (i == 0)\n\
+	{\n\
+		states[0] = k_initialState;\n\
+		begins[0] = (offset == 0 ? 0 : CLEX_SYNC_UNKNOWN);\n\
+		count = 1;\n\
+	}\n\
+	else\n\
+	{\n\
+		unsigned char c = (unsigned char)input[i - 1];\n\
+		if (c < 128)\n\
+		{\n\
+			for (size_t j = k_entryOffsets[c]; j < k_entryOffsets[c + 1]; ++j)\n\
+			{\n\
+				states[count] = k_entryStates[j];\n\
+				begins[count] = CLEX_SYNC_UNKNOWN;\n\
+				++count;\n\
+			}\n\
+		}\n\
+	}\n\
+	\n\
+	/* Runs that reject are dropped; runs in the same state with the same token start,\n\
+	 * known or not, scan the same from here on and are merged */\n\
+	for (; count > 1 && i < size; ++i)\n\
+	{\n\
+		unsigned char c = (unsigned char)input[i];\n\
+		size_t live = 0;\n\
+		for (size_t j = 0; j < count; ++j)\n\
+		{\n\
+			size_t state = states[j];\n\
+			size_t begin = begins[j];\n\
+			size_t next = CLex_Transition(state, c);\n\
+			if (!next)\n\
+			{\n\
+				if (k_states[state].type == TokenType_CLex_Reject)\n\
+				{\n\
+					continue;\n\
+				}\n\
+				begin = (i >= offset ? i : CLEX_SYNC_UNKNOWN);\n\
+				next = CLex_Transition(k_initialState, c);\n\
+				if (!next)\n\
+				{\n\
+					continue;\n\
+				}\n\
+			}\n\
+			\n\
+			bool merged = false;\n\
+			for (size_t k = 0; k < live && !merged; ++k)\n\
+			{\n\
+				merged = (states[k] == next && begins[k] == begin);\n\
+			}\n\
+			if (!merged)\n\
+			{\n\
+				states[live] = next;\n\
+				begins[live] = begin;\n\
+				++live;\n\
+			}\n\
+		}\n\
+		count = live;\n\
+	}\n\
+	if (count != 1)\n\
+	{\n\
+		return (count ? size : (size_t)-1);\n\
+	}\n\
+	if (begins[0] != CLEX_SYNC_UNKNOWN)\n\
+	{\n\
+		return begins[0];\n\
+	}\n\
+	\n\
+	/* A single run is left, which is the scan from the start of input */\n\
+	size_t state = states[0];\n\
+	for (; i < size; ++i)\n\
+	{\n\
+		unsigned char c = (unsigned char)input[i];\n\
+		size_t next = CLex_Transition(state, c);\n\
+		if (!next)\n\
+		{\n\
+			if (k_states[state].type == TokenType_CLex_Reject)\n\
+			{\n\
+				return (size_t)-1;\n\
+			}\n\
+			next = CLex_Transition(k_initialState, c);\n\
+			if (!next)\n\
+			{\n\
+				return (size_t)-1;\n\
+			}\n\
+			if (i >= offset)\n\
+			{\n\
+				return i;\n\
+			}\n\
+		}\n\
+		state = next;\n\
+	}\n\
+	return size;\n\
+}";
+	fputs(syncDefinition, output);
+}
+typedef struct KeywordHash KeywordHash;
+struct KeywordHash
+{
+	size_t positions[CODEGEN_KEYWORD_POSITIONS_MAX];
+	size_t positionsSize;
+	size_t sizeMax;
+	size_t bucketsSize;
+	uint32_t *seeds;
+	size_t *slots;
+};
+/* Packs the length, the first and last bytes and the chosen positions, which are
+ * clamped to the last byte for shorter tokens, into one key */
+static uint64_t KeywordHash_Key(const KeywordHash *hash, const char *text, size_t size)
+{
+	uint64_t key = (uint64_t)size;
+	key |= (uint64_t)(unsigned char)text[0] << 8;
+	key |= (uint64_t)(unsigned char)text[size - 1] << 16;
+	for (size_t i = 0; i < hash->positionsSize; ++i)
+	{
+		size_t position = (hash->positions[i] < size ? hash->positions[i] : size - 1);
+		key |= (uint64_t)(unsigned char)text[position] << (24 + 8 * i);
+	}
+	return key;
+}
+static size_t KeywordHash_Bucket(uint64_t key, size_t bucketsSize)
+{
+	return (size_t)((((key * 0x9E3779B97F4A7C15ull) >> 32) * bucketsSize) >> 32);
+}
+static size_t KeywordHash_Slot(uint64_t key, uint32_t seed, size_t slotsSize)
+{
+	return (size_t)((((key ^ seed) * 0xC2B2AE3D27D4EB4Full) >> 32) * slotsSize >> 32);
+}
+static int KeywordHash_CompareKeys(const void *lhs, const void *rhs)
+{
+	uint64_t left = *(const uint64_t *)lhs;
+	uint64_t right = *(const uint64_t *)rhs;
+	return (left > right) - (left < right);
+}
+static size_t KeywordHash_CountCollisions(const KeywordHash *hash, const CodegenKeyword *keywords, size_t keywordsSize, uint64_t *keys)
+{
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		keys[i] = KeywordHash_Key(hash, keywords[i].text, keywords[i].size);
+	}
+	qsort(keys, keywordsSize, sizeof(uint64_t), KeywordHash_CompareKeys);
+	size_t collisions = 0;
+	for (size_t i = 1; i < keywordsSize; ++i)
+	{
+		collisions += (keys[i] == keys[i - 1]);
+	}
+	return collisions;
+}
+/* Places every keyword of a bucket in a free slot with one seed, largest buckets first */
+static bool KeywordHash_FindSeeds(KeywordHash *hash, size_t keywordsSize, const uint64_t *keys)
+{
+	size_t *order = malloc(keywordsSize * sizeof(size_t));
+	size_t *bucketSizes = calloc(hash->bucketsSize, sizeof(size_t));
+	size_t *bucketOffsets = malloc((hash->bucketsSize + 1) * sizeof(size_t));
+	size_t *buckets = malloc(hash->bucketsSize * sizeof(size_t));
+	size_t *candidates = malloc(keywordsSize * sizeof(size_t));
+	bool *taken = calloc(keywordsSize, sizeof(bool));
+	
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		++bucketSizes[KeywordHash_Bucket(keys[i], hash->bucketsSize)];
+	}
+	bucketOffsets[0] = 0;
+	for (size_t i = 0; i < hash->bucketsSize; ++i)
+	{
+		bucketOffsets[i + 1] = bucketOffsets[i] + bucketSizes[i];
+		bucketSizes[i] = 0;
+		buckets[i] = i;
+	}
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		size_t bucket = KeywordHash_Bucket(keys[i], hash->bucketsSize);
+		order[bucketOffsets[bucket] + bucketSizes[bucket]++] = i;
+	}
+	for (size_t i = 1; i < hash->bucketsSize; ++i)
+	{
+		size_t bucket = buckets[i];
+		size_t j = i;
+		for (; j > 0 && bucketSizes[buckets[j - 1]] < bucketSizes[bucket]; --j)
+		{
+			buckets[j] = buckets[j - 1];
+		}
+		buckets[j] = bucket;
+	}
+	
+	bool found = true;
+	for (size_t i = 0; i < hash->bucketsSize && found; ++i)
+	{
+		size_t bucket = buckets[i];
+		const size_t *members = order + bucketOffsets[bucket];
+		found = false;
+		for (uint32_t seed = 0; seed < CODEGEN_KEYWORD_SEED_ATTEMPTS && !found; ++seed)
+		{
+			found = true;
+			for (size_t j = 0; j < bucketSizes[bucket] && found; ++j)
+			{
+				candidates[j] = KeywordHash_Slot(keys[members[j]], seed, keywordsSize);
+				found = !taken[candidates[j]];
+				for (size_t k = 0; k < j && found; ++k)
+				{
+					found = (candidates[k] != candidates[j]);
+				}
+			}
+			if (found)
+			{
+				hash->seeds[bucket] = seed;
+				for (size_t j = 0; j < bucketSizes[bucket]; ++j)
+				{
+					taken[candidates[j]] = true;
+					hash->slots[candidates[j]] = members[j];
+				}
+			}
+		}
+	}
+	
+	free(order);
+	free(bucketSizes);
+	free(bucketOffsets);
+	free(buckets);
+	free(candidates);
+	free(taken);
+	return found;
+}
+/* Builds a minimal perfect hash over the keywords. Positions beyond the first and last
+ * byte are added greedily until no two keywords share a key, then every bucket gets a
+ * seed that sends its keywords to distinct free slots. */
+static bool KeywordHash_Build(KeywordHash *hash, const CodegenKeyword *keywords, size_t keywordsSize)
+{
+	hash->positionsSize = 0;
+	hash->sizeMax = 0;
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		if (keywords[i].size > hash->sizeMax)
+		{
+			hash->sizeMax = keywords[i].size;
+		}
+	}
+	
+	uint64_t *keys = malloc(keywordsSize * sizeof(uint64_t));
+	size_t collisions = KeywordHash_CountCollisions(hash, keywords, keywordsSize, keys);
+	while (collisions && hash->positionsSize < CODEGEN_KEYWORD_POSITIONS_MAX)
+	{
+		size_t best = 0;
+		size_t bestCollisions = collisions;
+		for (size_t position = 1; position + 1 < hash->sizeMax; ++position)
+		{
+			hash->positions[hash->positionsSize++] = position;
+			size_t positionCollisions = KeywordHash_CountCollisions(hash, keywords, keywordsSize, keys);
+			--hash->positionsSize;
+			if (positionCollisions < bestCollisions)
+			{
+				best = position;
+				bestCollisions = positionCollisions;
+			}
+		}
+		if (!best)
+		{
+			break;
+		}
+		hash->positions[hash->positionsSize++] = best;
+		collisions = bestCollisions;
+	}
+	
+	hash->bucketsSize = keywordsSize / 2 + 1;
+	hash->seeds = NULL;
+	hash->slots = malloc(keywordsSize * sizeof(size_t));
+	bool found = false;
+	if (!collisions)
+	{
+		for (size_t i = 0; i < keywordsSize; ++i)
+		{
+			keys[i] = KeywordHash_Key(hash, keywords[i].text, keywords[i].size);
+		}
+		for (size_t attempt = 0; attempt < 4 && !found; ++attempt)
+		{
+			free(hash->seeds);
+			hash->seeds = calloc(hash->bucketsSize, sizeof(uint32_t));
+			found = KeywordHash_FindSeeds(hash, keywordsSize, keys);
+			if (!found)
+			{
+				hash->bucketsSize *= 2;
+			}
+		}
+	}
+	
+	free(keys);
+	return found;
+}
+static void KeywordHash_Destroy(KeywordHash *hash)
+{
+	free(hash->seeds);
+	free(hash->slots);
+}
+static void Codegen_WriteStringLiteral(FILE *output, const char *text, size_t size)
+{
+	fputc('"', output);
+	for (size_t i = 0; i < size; ++i)
+	{
+		unsigned char c = (unsigned char)text[i];
+		if (c == '"' || c == '\\')
+		{
+			fprintf(output, "\\%c", c);
+		}
+		else if (c >= ' ' && c < 127)
+		{
+			fputc(c, output);
+		}
+		else
+		{
+			fprintf(output, "\\%03o", c);
+		}
+	}
+	fputc('"', output);
+}
+static void Codegen_WriteKeywords(FILE *output, const KeywordHash *hash, const CodegenKeyword *keywords, size_t keywordsSize)
+{
+	fprintf(output, "\n#define CLEX_KEYWORD_SIZE_MAX %zu\n", hash->sizeMax);
+	const char *keywordStruct = "\n\
+typedef struct CLexKeyword CLexKeyword;\n\
+struct CLexKeyword\n\
+{\n\
+	const char *text;\n\
+	size_t size;\n\
+	TokenType base;\n\
+	TokenType type;\n\
+};\n\
+\n\
+static const CLexKeyword k_keywords[] =\n\
+{";
+	fputs(keywordStruct, output);
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		const CodegenKeyword *keyword = &keywords[hash->slots[i]];
+		fprintf(output, (i == 0 ? "\n\t{" : ",\n\t{"));
+		Codegen_WriteStringLiteral(output, keyword->text, keyword->size);
+		fprintf(output, ", %zu, TokenType_%s, TokenType_%s}", keyword->size, keyword->base, keyword->symbol);
+	}
+	fprintf(output, "\n};\n\nstatic const uint32_t k_keywordSeeds[] =\n{\n\t");
+	for (size_t i = 0; i < hash->bucketsSize; ++i)
+	{
+		fprintf(output, (i == 0 ? "%lu" : ", %lu"), (unsigned long)hash->seeds[i]);
+	}
+	
+	/* Only tokens of a base rule are looked up */
+	fprintf(output, "\n};\n\nstatic TokenType CLex_Classify(TokenType type, const char *token, size_t size)\n{\n\tif ((");
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		bool seen = false;
+		for (size_t j = 0; j < i && !seen; ++j)
+		{
+			seen = !strcmp(keywords[j].base, keywords[i].base);
+		}
+		if (!seen)
+		{
+			fprintf(output, (i == 0 ? "type != TokenType_%s" : " && type != TokenType_%s"), keywords[i].base);
+		}
+	}
+	fprintf(output, ") || size - 1 >= CLEX_KEYWORD_SIZE_MAX)\n\t{\n\t\treturn type;\n\t}\n\t\n");
+	fprintf(output, "\tuint64_t key = (uint64_t)size;\n");
+	fprintf(output, "\tkey |= (uint64_t)(unsigned char)token[0] << 8;\n");
+	fprintf(output, "\tkey |= (uint64_t)(unsigned char)token[size - 1] << 16;\n");
+	for (size_t i = 0; i < hash->positionsSize; ++i)
+	{
+		fprintf(output, "\tkey |= (uint64_t)(unsigned char)token[%zu < size ? %zu : size - 1] << %zu;\n", hash->positions[i], hash->positions[i], 24 + 8 * i);
+	}
+	fprintf(output, "\tuint64_t bucket = (((key * 0x9E3779B97F4A7C15ull) >> 32) * %zuu) >> 32;\n", hash->bucketsSize);
+	fprintf(output, "\tuint64_t slot = (((key ^ k_keywordSeeds[bucket]) * 0xC2B2AE3D27D4EB4Full) >> 32) * %zuu >> 32;\n", keywordsSize);
+	fprintf(output, "\tconst CLexKeyword *keyword = &k_keywords[slot];\n");
+	const char *classifyTail = "\
+	if (keyword->base == type && keyword->size == size && !memcmp(keyword->text, token, size))\n\
+	{\n\
+		return keyword->type;\n\
+	}\n\
+	return type;\n\
+}\n";
+	fputs(classifyTail, output);
+}
+static size_t Codegen_GetStateIndex(HashTable *stateToIndex, const DFAState *state)
+{
+	return (state ? (size_t)*HashTable_Find(stateToIndex, state) : 0);
+}
+/* Entries are the state after two bytes shifted left by one, or the state after one byte with the low bit set
+ * if the token ends in between, or 0 if the token ends before the first byte */
+static size_t Codegen_GetStride2EntrySize(const DFA *dfa)
+{
+	size_t entryMax = (dfa->states.size << 1) | 1;
+	return (entryMax <= 0xFFFF ? 2 : 4);
+}
+static size_t Codegen_GetStride2TableSize(const DFA *dfa, size_t classesSize)
+{
+	return (dfa->states.size + 1) * classesSize * classesSize * Codegen_GetStride2EntrySize(dfa);
+}
+static bool Codegen_WriteStride2(FILE *output, const CodegenOptions *options, const DFA *dfa, HashTable *stateToIndex, const char *clexSignature, const char *initialState)
+{
+	unsigned char classes[DFASTATE_EDGES_MAX];
+	size_t classesSize = DFA_ComputeByteClasses(dfa, classes);
+	
+	size_t entrySize = Codegen_GetStride2EntrySize(dfa);
+	size_t tableSize = Codegen_GetStride2TableSize(dfa, classesSize);
+	if (tableSize > options->stride2Limit)
+	{
+		fprintf(stderr, "clex: stride-2 table needs %zu bytes, over the %zu byte limit; using the byte table\n", tableSize, options->stride2Limit);
+		return false;
+	}
+	
+	int representatives[DFASTATE_EDGES_MAX];
+	for (int c = DFASTATE_EDGES_MAX - 1; c >= 0; --c)
+	{
+		representatives[classes[c]] = c;
+	}
+	
+	fprintf(output, "\n#define CLEX_CLASS_COUNT %zu\n\nstatic const unsigned char k_classes[256] =\n{\n\t", classesSize);
+	for (int c = 0; c < 256; ++c)
+	{
+		fprintf(output, (c == 0 ? "%i" : ", %i"), (c < DFASTATE_EDGES_MAX ? classes[c] : 0));
+	}
+	
+	fprintf(output, "\n};\n\nstatic const %s k_pairs[][CLEX_CLASS_COUNT * CLEX_CLASS_COUNT] =\n{\n\t{0}", (entrySize == 2 ? "uint16_t" : "uint32_t"));
+	for (size_t i = 0; i < dfa->states.size; ++i)
+	{
+		const DFAState *state = DFAStateVector_Get(&dfa->states, i);
+		fprintf(output, ",\n\t{");
+		for (size_t first = 0; first < classesSize; ++first)
+		{
+			const DFAState *middle = state->edges[representatives[first]];
+			for (size_t second = 0; second < classesSize; ++second)
+			{
+				size_t entry = 0;
+				if (middle)
+				{
+					const DFAState *end = middle->edges[representatives[second]];
+					entry = (end ? Codegen_GetStateIndex(stateToIndex, end) << 1 : (Codegen_GetStateIndex(stateToIndex, middle) << 1) | 1);
+				}
+				fprintf(output, (first == 0 && second == 0 ? "%zu" : ", %zu"), entry);
+			}
+		}
+		fprintf(output, "}");
+	}
+	fprintf(output, "\n};\n");
+	
+	fprintf(output, "\n%s\n{\n\tconst unsigned char *cursor = (const unsigned char *)*input;\n\tsize_t state = %s;\n", clexSignature, initialState);
+	const char *clexDefinition = "\
+	for (;;)\n\
+	{\n\
+		unsigned char first = cursor[0];\n\
+		unsigned char second = (first ? cursor[1] : 0);\n\
+		size_t entry = k_pairs[state][k_classes[first] * CLEX_CLASS_COUNT + k_classes[second]];\n\
+		if (!entry || (entry & 1))\n\
+		{\n\
+			state = (entry ? entry >> 1 : state);\n\
+			cursor += (entry & 1);\n\
+			break;\n\
+		}\n\
+		state = entry >> 1;\n\
+		cursor += 2;\n\
+	}\n\
+	*input = (const char *)cursor;\n\
+	return k_states[state].type;\n\
+}";
+	fputs(clexDefinition, output);
+	return true;
+}
+static void Codegen_WriteValues(FILE *output, const CodegenSymbol *symbols, size_t symbolsSize, bool modes)
+{
+	static const char *valueNames[] = {"None", "Decimal", "Hex", "Hash", "Escapes"};
+	bool used[CodegenValue_Escapes + 1] = {false};
+	
+	const char *kindsDeclaration = "\n\
+\n\
+enum\n\
+{\n\
+	CLexValue_None,\n\
+	CLexValue_Decimal,\n\
+	CLexValue_Hex,\n\
+	CLexValue_Hash,\n\
+	CLexValue_Escapes\n\
+};\n\
+\n\
+static const unsigned char k_valueKinds[] = {CLexValue_None";
+	fputs(kindsDeclaration, output);
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		fprintf(output, ", CLexValue_%s", valueNames[symbols[i].value]);
+		used[symbols[i].value] = true;
+	}
+	fprintf(output, "};");
+	
+	if (used[CodegenValue_Hex])
+	{
+		/* 16 marks bytes that are not hex digits */
+		fprintf(output, "\n\nstatic const unsigned char k_hexDigits[256] =\n{\n\t");
+		for (int c = 0; c < 256; ++c)
+		{
+			int digit = (c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16);
+			fprintf(output, (c == 0 ? "%i" : ", %i"), digit);
+		}
+		fprintf(output, "\n};");
+	}
+	
+	/* Only the accumulators the grammar uses are kept; each is updated without a branch on every byte */
+	const char *scanDefinition = "\n\
+\n\
+static TokenType CLex_ScanValue(const char **input, size_t initialState, uint64_t *value)\n\
+{\n\
+	const unsigned char *cursor = (const unsigned char *)*input;\n";
+	fputs(scanDefinition, output);
+	if (used[CodegenValue_Decimal])
+	{
+		fprintf(output, "\tuint64_t decimal = 0;\n");
+	}
+	if (used[CodegenValue_Hex])
+	{
+		fprintf(output, "\tuint64_t hex = 0;\n");
+	}
+	if (used[CodegenValue_Hash])
+	{
+		fprintf(output, "\tuint64_t hash = UINT64_C(14695981039346656037);\n");
+	}
+	if (used[CodegenValue_Escapes])
+	{
+		fprintf(output, "\tuint64_t escapes = 0;\n\tuint64_t escaped = 0;\n");
+	}
+	
+	const char *loopDefinition = "\
+	size_t lastState = initialState;\n\
+	size_t state = CLex_Transition(lastState, *cursor);\n\
+	while (state)\n\
+	{\n\
+		unsigned char c = *cursor;\n";
+	fputs(loopDefinition, output);
+	if (used[CodegenValue_Decimal])
+	{
+		fprintf(output, "\t\tuint64_t digit = (uint64_t)(c - '0');\n\t\tdecimal = (digit < 10 ? decimal * 10 + digit : decimal);\n");
+	}
+	if (used[CodegenValue_Hex])
+	{
+		fprintf(output, "\t\tuint64_t hexDigit = k_hexDigits[c];\n\t\thex = (hexDigit < 16 ? hex * 16 + hexDigit : hex);\n");
+	}
+	if (used[CodegenValue_Hash])
+	{
+		fprintf(output, "\t\thash = (hash ^ c) * UINT64_C(1099511628211);\n");
+	}
+	if (used[CodegenValue_Escapes])
+	{
+		fprintf(output, "\t\tescaped = (c == '\\\\') & !escaped;\n\t\tescapes += escaped;\n");
+	}
+	
+	const char *resultDefinition = "\
+		++cursor;\n\
+		lastState = state;\n\
+		state = CLex_Transition(lastState, *cursor);\n\
+	}\n\
+	const char *begin = *input;\n\
+	*input = (const char *)cursor;\n\
+	TokenType type = CLex_Classify(k_states[lastState].type, begin, (size_t)(*input - begin));\n\
+	switch (k_valueKinds[type])\n\
+	{\n";
+	fputs(resultDefinition, output);
+	static const char *accumulatorNames[] = {NULL, "decimal", "hex", "hash", "escapes"};
+	for (int kind = CodegenValue_Decimal; kind <= CodegenValue_Escapes; ++kind)
+	{
+		if (used[kind])
+		{
+			fprintf(output, "\t\tcase CLexValue_%s:\n\t\t\t*value = %s;\n\t\t\tbreak;\n", valueNames[kind], accumulatorNames[kind]);
+		}
+	}
+	
+	const char *valueDefinition = "\
+		default:\n\
+			*value = 0;\n\
+			break;\n\
+	}\n\
+	return type;\n\
+}\n\
+\n\
+TokenType CLex_Value(const char **input, uint64_t *value)\n\
+{\n\
+	return CLex_ScanValue(input, k_initialState, value);\n\
+}";
+	fputs(valueDefinition, output);
+	if (modes)
+	{
+		const char *modeValueDefinition = "\n\
+\n\
+TokenType CLex_ModeValue(const char **input, CLexMode mode, uint64_t *value)\n\
+{\n\
+	return CLex_ScanValue(input, k_initialStates[mode], value);\n\
+}";
+		fputs(modeValueDefinition, output);
+	}
+}
+static void Codegen_WriteTags(FILE *output, const DFA *dfa, const CodegenSymbol *symbols, size_t symbolsSize, bool modes)
+{
+	size_t registers = 0;
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		if ((symbols[i].groupsBegin + symbols[i].groupsSize) * 2 > registers)
+		{
+			registers = (symbols[i].groupsBegin + symbols[i].groupsSize) * 2;
+		}
+	}
+	
+	const char *tagStateDeclaration = "\n\
+\n\
+typedef struct TagState TagState;\n\
+struct TagState\n\
+{\n\
+	uint64_t set;\n\
+	uint64_t unset;\n\
+	uint64_t start;\n\
+};\n\
+\n\
+static const TagState k_tagStates[] =\n\
+{\n\
+	{0, 0, 0}";
+	fputs(tagStateDeclaration, output);
+	for (size_t i = 0; i < dfa->states.size; ++i)
+	{
+		const DFAState *state = DFAStateVector_Get(&dfa->states, i);
+		fprintf(output, ",\n\t{0x%zx, 0x%zx, 0x%zx}", state->tagsSet, state->tagsUnset, state->tagsStart);
+	}
+	
+	fprintf(output, "\n};\n\n#define CLEX_TAG_REGISTERS %zu\n\nstatic const unsigned char k_tagsBegin[] = {0", registers);
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		fprintf(output, ", %zu", symbols[i].groupsBegin * 2);
+	}
+	fprintf(output, "};\nstatic const unsigned char k_tagsSize[] = {0");
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		fprintf(output, ", %zu", symbols[i].groupsSize * 2);
+	}
+	fprintf(output, "};");
+	
+	const char *tagsDefinition = "\n\
+\n\
+static TokenType CLex_ScanTags(const char **input, size_t initialState, size_t *tags)\n\
+{\n\
+	const char *begin = *input;\n\
+	size_t registers[CLEX_TAG_REGISTERS] = {0};\n\
+	size_t lastState = initialState;\n\
+	size_t state = CLex_Transition(lastState, (unsigned char)**input);\n\
+	while (state)\n\
+	{\n\
+		++*input;\n\
+		lastState = state;\n\
+		uint64_t set = k_tagStates[state].set;\n\
+		for (size_t tag = 0; set; set >>= 1, ++tag)\n\
+		{\n\
+			if (set & 1)\n\
+			{\n\
+				registers[tag] = (size_t)(*input - begin);\n\
+			}\n\
+		}\n\
+		state = CLex_Transition(lastState, (unsigned char)**input);\n\
+	}\n\
+	TokenType type = CLex_Classify(k_states[lastState].type, begin, (size_t)(*input - begin));\n\
+	\n\
+	/* Tags the final state knows without a register are unset or at the token start */\n\
+	const TagState *final = &k_tagStates[lastState];\n\
+	for (size_t i = 0; i < k_tagsSize[type]; ++i)\n\
+	{\n\
+		size_t tag = k_tagsBegin[type] + i;\n\
+		uint64_t bit = (uint64_t)1 << tag;\n\
+		tags[i] = ((final->unset & bit) ? (size_t)-1 : (final->start & bit) ? 0 : registers[tag]);\n\
+	}\n\
+	return type;\n\
+}\n\
+\n\
+TokenType CLex_Tags(const char **input, size_t *tags)\n\
+{\n\
+	return CLex_ScanTags(input, k_initialState, tags);\n\
+}";
+	fputs(tagsDefinition, output);
+	if (modes)
+	{
+		const char *modeTagsDefinition = "\n\
+\n\
+TokenType CLex_ModeTags(const char **input, CLexMode mode, size_t *tags)\n\
+{\n\
+	return CLex_ScanTags(input, k_initialStates[mode], tags);\n\
+}";
+		fputs(modeTagsDefinition, output);
+	}
+}
+static void Codegen_WriteIntern(FILE *output, const CodegenSymbol *symbols, size_t symbolsSize, bool modes)
+{
+	fprintf(output, "\n\nstatic const unsigned char k_interned[] = {0");
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		fprintf(output, ", %i", (symbols[i].intern ? 1 : 0));
+	}
+	
+	const char *poolDefinition = "};\n\
+\n\
+void CLexPool_Create(CLexPool *pool)\n\
+{\n\
+	memset(pool, 0, sizeof(CLexPool));\n\
+}\n\
+\n\
+void CLexPool_Destroy(CLexPool *pool)\n\
+{\n\
+	free(pool->slots);\n\
+	free(pool->entries);\n\
+	free(pool->text);\n\
+	memset(pool, 0, sizeof(CLexPool));\n\
+}\n\
+\n\
+size_t CLexPool_Size(const CLexPool *pool)\n\
+{\n\
+	return pool->entriesSize;\n\
+}\n\
+\n\
+const char *CLexPool_Get(const CLexPool *pool, size_t id, size_t *size)\n\
+{\n\
+	*size = pool->entries[id].size;\n\
+	return pool->text + pool->entries[id].offset;\n\
+}\n\
+\n\
+static size_t CLexPool_Home(const CLexPool *pool, uint64_t hash)\n\
+{\n\
+	return (size_t)(hash ^ (hash >> 32)) & (pool->slotsCapacity - 1);\n\
+}\n\
+\n\
+/* Keeps the table at most half full, so probe sequences stay short */\n\
+static int CLexPool_Reserve(CLexPool *pool, size_t size)\n\
+{\n\
+	if (pool->entriesSize == pool->entriesCapacity)\n\
+	{\n\
+		size_t capacity = (pool->entriesCapacity ? pool->entriesCapacity * 2 : 64);\n\
+		CLexPoolEntry *entries = realloc(pool->entries, capacity * sizeof(CLexPoolEntry));\n\
+		if (!entries)\n\
+		{\n\
+			return 0;\n\
+		}\n\
+		pool->entries = entries;\n\
+		pool->entriesCapacity = capacity;\n\
+	}\n\
+	if (pool->textCapacity - pool->textSize <= size)\n\
+	{\n\
+		size_t capacity = (pool->textCapacity ? pool->textCapacity * 2 : 1024);\n\
+		while (capacity - pool->textSize <= size)\n\
+		{\n\
+			capacity *= 2;\n\
+		}\n\
+		char *text = realloc(pool->text, capacity);\n\
+		if (!text)\n\
+		{\n\
+			return 0;\n\
+		}\n\
+		pool->text = text;\n\
+		pool->textCapacity = capacity;\n\
+	}\n\
+	if ((pool->entriesSize + 1) * 2 > pool->slotsCapacity)\n\
+	{\n\
+		size_t capacity = (pool->slotsCapacity ? pool->slotsCapacity * 2 : 128);\n\
+		uint32_t *slots = calloc(capacity, sizeof(uint32_t));\n\
+		if (!slots)\n\
+		{\n\
+			return 0;\n\
+		}\n\
+		free(pool->slots);\n\
+		pool->slots = slots;\n\
+		pool->slotsCapacity = capacity;\n\
+		for (size_t id = 0; id < pool->entriesSize; ++id)\n\
+		{\n\
+			size_t slot = CLexPool_Home(pool, pool->entries[id].hash);\n\
+			while (pool->slots[slot])\n\
+			{\n\
+				slot = (slot + 1) & (capacity - 1);\n\
+			}\n\
+			pool->slots[slot] = (uint32_t)(id + 1);\n\
+		}\n\
+	}\n\
+	return 1;\n\
+}\n\
+\n\
+static size_t CLexPool_Intern(CLexPool *pool, const char *token, size_t size, uint64_t hash)\n\
+{\n\
+	if (pool->slotsCapacity)\n\
+	{\n\
+		for (size_t slot = CLexPool_Home(pool, hash); pool->slots[slot]; slot = (slot + 1) & (pool->slotsCapacity - 1))\n\
+		{\n\
+			const CLexPoolEntry *entry = &pool->entries[pool->slots[slot] - 1];\n\
+			if (entry->hash == hash && entry->size == size && !memcmp(pool->text + entry->offset, token, size))\n\
+			{\n\
+				return pool->slots[slot] - 1;\n\
+			}\n\
+		}\n\
+	}\n\
+	if (pool->entriesSize >= UINT32_MAX || !CLexPool_Reserve(pool, size))\n\
+	{\n\
+		return (size_t)-1;\n\
+	}\n\
+	\n\
+	size_t id = pool->entriesSize++;\n\
+	CLexPoolEntry *entry = &pool->entries[id];\n\
+	entry->hash = hash;\n\
+	entry->offset = pool->textSize;\n\
+	entry->size = size;\n\
+	memcpy(pool->text + pool->textSize, token, size);\n\
+	pool->text[pool->textSize + size] = 0;\n\
+	pool->textSize += size + 1;\n\
+	\n\
+	size_t slot = CLexPool_Home(pool, hash);\n\
+	while (pool->slots[slot])\n\
+	{\n\
+		slot = (slot + 1) & (pool->slotsCapacity - 1);\n\
+	}\n\
+	pool->slots[slot] = (uint32_t)(id + 1);\n\
+	return id;\n\
+}\n\
+\n\
+static TokenType CLex_ScanIntern(const char **input, size_t initialState, CLexPool *pool, size_t *id)\n\
+{\n\
+	const char *begin = *input;\n\
+	uint64_t hash = UINT64_C(14695981039346656037);\n\
+	size_t lastState = initialState;\n\
+	size_t state = CLex_Transition(lastState, (unsigned char)**input);\n\
+	while (state)\n\
+	{\n\
+		hash = (hash ^ (unsigned char)**input) * UINT64_C(1099511628211);\n\
+		++*input;\n\
+		lastState = state;\n\
+		state = CLex_Transition(lastState, (unsigned char)**input);\n\
+	}\n\
+	size_t size = (size_t)(*input - begin);\n\
+	TokenType type = CLex_Classify(k_states[lastState].type, begin, size);\n\
+	*id = (k_interned[type] ? CLexPool_Intern(pool, begin, size, hash) : (size_t)-1);\n\
+	return type;\n\
+}\n\
+\n\
+TokenType CLex_Intern(const char **input, CLexPool *pool, size_t *id)\n\
+{\n\
+	return CLex_ScanIntern(input, k_initialState, pool, id);\n\
+}";
+	fputs(poolDefinition, output);
+	if (modes)
+	{
+		const char *modeInternDefinition = "\n\
+\n\
+TokenType CLex_ModeIntern(const char **input, CLexMode mode, CLexPool *pool, size_t *id)\n\
+{\n\
+	return CLex_ScanIntern(input, k_initialStates[mode], pool, id);\n\
+}";
+		fputs(modeInternDefinition, output);
+	}
+}
+static void Codegen_WritePrelude(FILE *output, const CodegenOptions *options)
+{
+	if (options->mmap || options->parallel)
+	{
+		fprintf(output, "\n#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)\n#define _DEFAULT_SOURCE\n#endif\n");
+	}
+}
+static void Codegen_WriteIncludes(FILE *output, const CodegenOptions *options, bool keywords, bool tags, bool intern)
+{
+	if (options->parallel || options->incremental || intern)
+	{
+		fprintf(output, "\n#include <stdlib.h>\n");
+	}
+	if (options->stream || options->incremental || options->profile || keywords || intern)
+	{
+		fprintf(output, "\n#include <string.h>\n");
+	}
+	if (options->stride2 || options->recover || keywords || tags)
+	{
+		fprintf(output, "\n#include <stdint.h>\n");
+	}
+	if (options->mmap)
+	{
+		const char *mmapIncludes = "\n\
+#if defined(_WIN32)\n\
+#include <windows.h>\n\
+#include <stdlib.h>\n\
+#else\n\
+#include <fcntl.h>\n\
+#include <sys/mman.h>\n\
+#include <sys/stat.h>\n\
+#include <unistd.h>\n\
+#endif\n\
+";
+		fputs(mmapIncludes, output);
+	}
+	if (options->parallel)
+	{
+		const char *parallelIncludes = "\n\
+#if defined(_WIN32)\n\
+#include <windows.h>\n\
+#else\n\
+#include <pthread.h>\n\
+#endif\n\
+";
+		fputs(parallelIncludes, output);
+	}
+	if (options->many)
+	{
+		fprintf(output, "\n#if defined(_MSC_VER)\n#include <xmmintrin.h>\n#endif\n");
 	}
-	else
+	if (options->recover)
 	{
-		fprintf(output, "TokenType_CLex_Reject, {[0] = 0");
+		const char *recoverIncludes = "\n\
+#if !defined(CLEX_SSSE3) && (defined(__SSSE3__) || defined(__AVX__))\n\
+#define CLEX_SSSE3\n\
+#endif\n\
+#if defined(CLEX_SSSE3)\n\
+#include <tmmintrin.h>\n\
+#if defined(_MSC_VER)\n\
+#include <intrin.h>\n\
+#endif\n\
+#endif\n\
+";
+		fputs(recoverIncludes, output);
 	}
-	
-	bool first = true;
-	for (int i = 0; i < DFASTATE_EDGES_MAX; ++i)
+	if (options->lines && options->stream)
 	{
-		if (state->edges[i])
-		{
-			fprintf(output, ", [%i] = %zu", i, (size_t)*HashTable_Find(stateToIndex, state->edges[i]));
-			first = false;
-		}
+		const char *linesIncludes = "\n\
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)\n\
+#include <emmintrin.h>\n\
+#define CLEX_SSE2\n\
+#elif defined(__ARM_NEON) && defined(__aarch64__)\n\
+#include <arm_neon.h>\n\
+#define CLEX_NEON\n\
+#endif\n\
+";
+		fputs(linesIncludes, output);
 	}
-	
-	fprintf(output, "}}");
 }
 static size_t DFA_HashDFAState(const void *data)
 {
@@ -45,20 +2792,141 @@ static bool DFA_CompareDFAState(const void *lhs, const void *rhs)
 {
 	return lhs == rhs;
 }
-void Codegen_WriteSource(FILE *output, const DFA *dfa, const DFAState *start, const char *outputHeaderPath)
+static void Codegen_WriteProfile(FILE *output, const DFA *dfa, const CodegenSymbol *symbols, size_t symbolsSize)
+{
+	fprintf(output, "\n#if defined(CLEX_PROFILE)\n\n#define CLEX_PROFILE_STATES %zu\n#define CLEX_PROFILE_TYPES %zu\n\nstatic const char *const k_profileNames[] = {\"CLex_Reject\"", dfa->states.size + 1, symbolsSize + 1);
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		fprintf(output, ", \"%s\"", symbols[i].name);
+	}
+	
+	const char *profileDefinition = "};\n\
+\n\
+typedef struct CLexProfile CLexProfile;\n\
+struct CLexProfile\n\
+{\n\
+	size_t transitions[CLEX_PROFILE_STATES];\n\
+	size_t tokens[CLEX_PROFILE_TYPES];\n\
+	size_t bytes[CLEX_PROFILE_TYPES];\n\
+};\n\
+\n\
+static CLexProfile s_profile;\n\
+\n\
+#define CLEX_PROFILE_TRANSITION(state) (++s_profile.transitions[state])\n\
+#define CLEX_PROFILE_TOKEN(type, size) (++s_profile.tokens[type], s_profile.bytes[type] += (size))\n\
+\n\
+void CLex_DumpProfile(FILE *output)\n\
+{\n\
+	for (size_t i = 0; i < CLEX_PROFILE_TYPES; ++i)\n\
+	{\n\
+		if (s_profile.tokens[i])\n\
+		{\n\
+			fprintf(output, \"rule %s %zu %zu\\n\", k_profileNames[i], s_profile.tokens[i], s_profile.bytes[i]);\n\
+		}\n\
+	}\n\
+	for (size_t i = 1; i < CLEX_PROFILE_STATES; ++i)\n\
+	{\n\
+		if (s_profile.transitions[i])\n\
+		{\n\
+			fprintf(output, \"state %zu %zu %s\\n\", i, s_profile.transitions[i], k_profileNames[k_states[i].type]);\n\
+		}\n\
+	}\n\
+}\n\
+\n\
+void CLex_ResetProfile(void)\n\
+{\n\
+	memset(&s_profile, 0, sizeof(CLexProfile));\n\
+}\n\
+#else\n\
+#define CLEX_PROFILE_TRANSITION(state) ((void)0)\n\
+#define CLEX_PROFILE_TOKEN(type, size) ((void)(size))\n\
+#endif\n";
+	fputs(profileDefinition, output);
+}
+/* With profile, the loop counts its transitions, and its tokens too if it is CLex itself rather than
+ * CLex_Match; the counters are only compiled in with CLEX_PROFILE */
+static void Codegen_WriteByteScan(FILE *output, const char *clexSignature, const char *initialState, bool profile, bool profileTokens)
+{
+	fprintf(output, "\n%s\n{\n\tsize_t lastState = %s;\n", clexSignature, initialState);
+	if (!profile)
+	{
+		const char *clexDefinition = "\
+	size_t state = k_states[lastState].edges[**input];\n\
+	while (state)\n\
+	{\n\
+		++*input;\n\
+		lastState = state;\n\
+		state = k_states[lastState].edges[**input];\n\
+	}\n\
+	return k_states[lastState].type;\n\
+}";
+		fputs(clexDefinition, output);
+		return;
+	}
+	
+	if (profileTokens)
+	{
+		fprintf(output, "\tconst char *begin = *input;\n");
+	}
+	const char *loopDefinition = "\
+	size_t state = k_states[lastState].edges[**input];\n\
+	while (state)\n\
+	{\n\
+		CLEX_PROFILE_TRANSITION(lastState);\n\
+		++*input;\n\
+		lastState = state;\n\
+		state = k_states[lastState].edges[**input];\n\
+	}\n";
+	fputs(loopDefinition, output);
+	if (profileTokens)
+	{
+		fprintf(output, "\tCLEX_PROFILE_TOKEN(k_states[lastState].type, (size_t)(*input - begin));\n");
+	}
+	fprintf(output, "\treturn k_states[lastState].type;\n}");
+}
+size_t Codegen_GetTableSize(const CodegenOptions *options, const DFA *dfa)
+{
+	/* k_states holds a type and 128 edges per state, after the reject state */
+	size_t result = (dfa->states.size + 1) * 129 * sizeof(size_t);
+	if (options->stride2)
+	{
+		unsigned char classes[DFASTATE_EDGES_MAX];
+		size_t stride2Size = Codegen_GetStride2TableSize(dfa, DFA_ComputeByteClasses(dfa, classes));
+		if (stride2Size <= options->stride2Limit)
+		{
+			result += 256 + stride2Size;
+		}
+	}
+	return result;
+}
+bool Codegen_WriteSource(FILE *output, const CodegenOptions *options, const DFA *dfa, DFAState *const *starts, size_t startsSize, const CodegenSymbol *symbols, size_t symbolsSize, const CodegenKeyword *keywords, size_t keywordsSize, const char *outputHeaderPath)
 {
+	bool values = Codegen_HasValues(symbols, symbolsSize);
+	bool tags = Codegen_HasTags(symbols, symbolsSize);
+	bool intern = Codegen_HasIntern(symbols, symbolsSize);
+	bool usesTransition = (Codegen_UsesTransition(options) || values || tags || intern);
+	
+	KeywordHash keywordHash;
+	if (keywordsSize && !KeywordHash_Build(&keywordHash, keywords, keywordsSize))
+	{
+		KeywordHash_Destroy(&keywordHash);
+		return false;
+	}
+	
 	HashTable stateToIndex;
 	HashTable_Create(&stateToIndex, dfa->states.size + dfa->states.size / 2, 1.0f, DFA_HashDFAState, DFA_CompareDFAState);
 	
 	for (size_t i = 0; i < dfa->states.size; ++i)
 	{
-		HashTable_Insert(&stateToIndex, Vector_Get(&dfa->states, i), (void *)(i + 1));
+		HashTable_Insert(&stateToIndex, DFAStateVector_Get(&dfa->states, i), (void *)(i + 1));
 	}
 	
-	const char *header = "/* Generated by CLex */\n\
-\n\
-#include \"%s\"\n\
-\n\
+	fprintf(output, "/* Generated by CLex */\n");
+	Codegen_WritePrelude(output, options);
+	fprintf(output, "\n#include \"%s\"\n", outputHeaderPath);
+	Codegen_WriteIncludes(output, options, keywordsSize != 0, tags, intern);
+	
+	const char *header = "\n\
 typedef struct State State;\n\
 struct State\n\
 {\n\
@@ -70,34 +2938,450 @@ static const State k_states[] =\n\
 {\n\
 	{TokenType_CLex_Reject, {[0] = 0}},\n\
 ";
-	fprintf(output, header, outputHeaderPath);
+	fprintf(output, header);
 	for (size_t i = 0; i < dfa->states.size; ++i)
 	{
 		if (i != 0)
 		{
 			fprintf(output, ",\n");
 		}
-		Codegen_WriteDFAState(output, Vector_Get(&dfa->states, i), &stateToIndex);
+		Codegen_WriteDFAState(output, DFAStateVector_Get(&dfa->states, i), &stateToIndex);
 	}
 	const char *footer = "\n};\n";
 	fprintf(output, footer);
 	
-	fprintf(output, "\nstatic const size_t k_initialState = %zu;\n", (size_t)*HashTable_Find(&stateToIndex, start));
+	/* With modes, the entry points that always scan in the default mode read its start through k_initialState,
+	 * which is only a name for it, so that plain mode scanners do not define a constant they never use */
+	if (startsSize == 1)
+	{
+		fprintf(output, "\nstatic const size_t k_initialState = %zu;\n", (size_t)*HashTable_Find(&stateToIndex, starts[0]));
+	}
+	else
+	{
+		fprintf(output, "\nstatic const size_t k_initialStates[] = {%zu", (size_t)*HashTable_Find(&stateToIndex, starts[0]));
+		for (size_t i = 1; i < startsSize; ++i)
+		{
+			fprintf(output, ", %zu", (size_t)*HashTable_Find(&stateToIndex, starts[i]));
+		}
+		fprintf(output, "};\n#define k_initialState (k_initialStates[0])\n");
+	}
+	
+	/* With keywords, CLex wraps the DFA scan and reclassifies its result; with modes, the scan
+	 * also takes the state to start from */
+	const char *clexSignature = "TokenType CLex(const char **input)";
+	const char *initialState = "k_initialState";
+	if (keywordsSize)
+	{
+		Codegen_WriteKeywords(output, &keywordHash, keywords, keywordsSize);
+		clexSignature = "static TokenType CLex_Match(const char **input)";
+	}
+	else if (usesTransition)
+	{
+		fprintf(output, "\n#define CLex_Classify(type, token, size) (type)\n");
+	}
+	if (startsSize > 1)
+	{
+		clexSignature = "static TokenType CLex_Match(const char **input, size_t initialState)";
+		initialState = "initialState";
+	}
 	
-	const char *clexDefinition = "\n\
+	/* The profiling build always scans a byte at a time, so that every state's transitions are counted */
+	bool profileTokens = (startsSize == 1 && !keywordsSize);
+	if (options->profile)
+	{
+		Codegen_WriteProfile(output, dfa, symbols, symbolsSize);
+	}
+	if (options->stride2 && options->profile)
+	{
+		fprintf(output, "\n#if !defined(CLEX_PROFILE)\n");
+	}
+	bool stride2 = (options->stride2 && Codegen_WriteStride2(output, options, dfa, &stateToIndex, clexSignature, initialState));
+	if (options->stride2 && options->profile)
+	{
+		fprintf(output, (stride2 ? "\n#else\n" : "#endif\n"));
+	}
+	if (!stride2 || options->profile)
+	{
+		Codegen_WriteByteScan(output, clexSignature, initialState, options->profile, profileTokens);
+	}
+	if (stride2 && options->profile)
+	{
+		fprintf(output, "\n#endif");
+	}
+	if (startsSize > 1)
+	{
+		fprintf(output, "\n\nTokenType CLex_Mode(const char **input, CLexMode mode)\n{\n");
+		if (options->profile)
+		{
+			fprintf(output, "\tconst char *begin = *input;\n\tTokenType type = CLex_Match(input, k_initialStates[mode]);\n");
+			if (keywordsSize)
+			{
+				fprintf(output, "\ttype = CLex_Classify(type, begin, (size_t)(*input - begin));\n");
+			}
+			fprintf(output, "\tCLEX_PROFILE_TOKEN(type, (size_t)(*input - begin));\n\treturn type;\n}");
+		}
+		else if (keywordsSize)
+		{
+			const char *classifyDefinition = "\
+	const char *begin = *input;\n\
+	TokenType type = CLex_Match(input, k_initialStates[mode]);\n\
+	return CLex_Classify(type, begin, (size_t)(*input - begin));\n\
+}";
+			fputs(classifyDefinition, output);
+		}
+		else
+		{
+			fprintf(output, "\treturn CLex_Match(input, k_initialStates[mode]);\n}");
+		}
+		
+		const char *clexDefinition = "\n\
+\n\
 TokenType CLex(const char **input)\n\
 {\n\
-	size_t lastState = k_initialState;\n\
-	size_t state = k_states[lastState].edges[**input];\n\
-	while (state)\n\
+	return CLex_Mode(input, CLexMode_Default);\n\
+}";
+		fputs(clexDefinition, output);
+	}
+	else if (keywordsSize && options->profile)
+	{
+		const char *profileDefinition = "\n\
+\n\
+TokenType CLex(const char **input)\n\
+{\n\
+	const char *begin = *input;\n\
+	TokenType type = CLex_Match(input);\n\
+	type = CLex_Classify(type, begin, (size_t)(*input - begin));\n\
+	CLEX_PROFILE_TOKEN(type, (size_t)(*input - begin));\n\
+	return type;\n\
+}";
+		fputs(profileDefinition, output);
+	}
+	else if (keywordsSize)
+	{
+		const char *classifyDefinition = "\n\
+\n\
+TokenType CLex(const char **input)\n\
+{\n\
+	const char *begin = *input;\n\
+	TokenType type = CLex_Match(input);\n\
+	return CLex_Classify(type, begin, (size_t)(*input - begin));\n\
+}";
+		fputs(classifyDefinition, output);
+	}
+	
+	if (usesTransition)
+	{
+		Codegen_WriteTransition(output);
+	}
+	if (options->lines)
+	{
+		Codegen_WriteLines(output);
+	}
+	if (options->lines && options->stream)
+	{
+		Codegen_WriteAdvance(output, dfa, &stateToIndex, symbols, symbolsSize);
+	}
+	if (options->push)
+	{
+		Codegen_WritePush(output, keywordsSize != 0, startsSize > 1);
+	}
+	if (options->stream)
+	{
+		Codegen_WriteStream(output, startsSize > 1, options->lines);
+	}
+	if (options->mmap)
+	{
+		Codegen_WriteMmap(output);
+	}
+	if (options->parallel)
+	{
+		Codegen_WriteScan(output);
+	}
+	if (options->parallel || options->sync)
+	{
+		Codegen_WriteEntryStates(output, dfa, &stateToIndex);
+	}
+	if (options->parallel)
+	{
+		Codegen_WriteParallel(output);
+	}
+	if (options->many)
+	{
+		Codegen_WriteMany(output);
+	}
+	if (options->incremental)
+	{
+		Codegen_WriteIncremental(output);
+	}
+	if (options->sync)
+	{
+		Codegen_WriteSync(output);
+	}
+	if (options->recover)
+	{
+		Codegen_WriteRecover(output, starts, startsSize);
+	}
+	if (values)
+	{
+		Codegen_WriteValues(output, symbols, symbolsSize, startsSize > 1);
+	}
+	if (tags)
+	{
+		Codegen_WriteTags(output, dfa, symbols, symbolsSize, startsSize > 1);
+	}
+	if (intern)
+	{
+		Codegen_WriteIntern(output, symbols, symbolsSize, startsSize > 1);
+	}
+	
+	HashTable_Destroy(&stateToIndex);
+	if (keywordsSize)
+	{
+		KeywordHash_Destroy(&keywordHash);
+	}
+	return true;
+}
+static void Codegen_WriteCppKeywords(FILE *output, const KeywordHash *hash, const CodegenKeyword *keywords, size_t keywordsSize)
+{
+	const char *keywordStruct = "\n\
+struct Keyword\n\
+{\n\
+	std::string_view text;\n\
+	TokenType base;\n\
+	TokenType type;\n\
+};\n\
+\n";
+	fputs(keywordStruct, output);
+	fprintf(output, "inline constexpr std::size_t k_keywordSizeMax = %zu;\n\ninline constexpr Keyword k_keywords[] =\n{", hash->sizeMax);
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		const CodegenKeyword *keyword = &keywords[hash->slots[i]];
+		fprintf(output, (i == 0 ? "\n\t{std::string_view(" : ",\n\t{std::string_view("));
+		Codegen_WriteStringLiteral(output, keyword->text, keyword->size);
+		fprintf(output, ", %zu), TokenType::%s, TokenType::%s}", keyword->size, keyword->base, keyword->symbol);
+	}
+	fprintf(output, "\n};\n\ninline constexpr std::uint32_t k_keywordSeeds[] =\n{\n\t");
+	for (size_t i = 0; i < hash->bucketsSize; ++i)
+	{
+		fprintf(output, (i == 0 ? "%lu" : ", %lu"), (unsigned long)hash->seeds[i]);
+	}
+	
+	/* The same perfect hash as CLex_Classify, over the first bytes of the token that scan keeps */
+	fprintf(output, "\n};\n\nconstexpr TokenType classify(TokenType type, const char *token, std::size_t size)\n{\n\tif ((");
+	for (size_t i = 0; i < keywordsSize; ++i)
+	{
+		bool seen = false;
+		for (size_t j = 0; j < i && !seen; ++j)
+		{
+			seen = !strcmp(keywords[j].base, keywords[i].base);
+		}
+		if (!seen)
+		{
+			fprintf(output, (i == 0 ? "type != TokenType::%s" : " && type != TokenType::%s"), keywords[i].base);
+		}
+	}
+	fprintf(output, ") || size - 1 >= k_keywordSizeMax)\n\t{\n\t\treturn type;\n\t}\n\t\n");
+	fprintf(output, "\tstd::uint64_t key = static_cast<std::uint64_t>(size);\n");
+	fprintf(output, "\tkey |= static_cast<std::uint64_t>(static_cast<unsigned char>(token[0])) << 8;\n");
+	fprintf(output, "\tkey |= static_cast<std::uint64_t>(static_cast<unsigned char>(token[size - 1])) << 16;\n");
+	for (size_t i = 0; i < hash->positionsSize; ++i)
+	{
+		fprintf(output, "\tkey |= static_cast<std::uint64_t>(static_cast<unsigned char>(token[%zu < size ? %zu : size - 1])) << %zu;\n", hash->positions[i], hash->positions[i], 24 + 8 * i);
+	}
+	fprintf(output, "\tstd::uint64_t bucket = (((key * 0x9E3779B97F4A7C15ull) >> 32) * %zuu) >> 32;\n", hash->bucketsSize);
+	fprintf(output, "\tstd::uint64_t slot = (((key ^ k_keywordSeeds[bucket]) * 0xC2B2AE3D27D4EB4Full) >> 32) * %zuu >> 32;\n", keywordsSize);
+	const char *classifyTail = "\
+	const Keyword &keyword = k_keywords[slot];\n\
+	if (keyword.base == type && keyword.text == std::string_view(token, size))\n\
 	{\n\
-		++*input;\n\
-		lastState = state;\n\
-		state = k_states[lastState].edges[**input];\n\
+		return keyword.type;\n\
 	}\n\
-	return k_states[lastState].type;\n\
+	return type;\n\
+}\n";
+	fputs(classifyTail, output);
+}
+bool Codegen_WriteCpp(FILE *output, const CodegenOptions *options, const DFA *dfa, DFAState *const *starts, size_t startsSize, const CodegenSymbol *symbols, size_t symbolsSize, const char **modes, const CodegenKeyword *keywords, size_t keywordsSize)
+{
+	KeywordHash keywordHash;
+	if (keywordsSize && !KeywordHash_Build(&keywordHash, keywords, keywordsSize))
+	{
+		KeywordHash_Destroy(&keywordHash);
+		return false;
+	}
+	
+	HashTable stateToIndex;
+	HashTable_Create(&stateToIndex, dfa->states.size + dfa->states.size / 2, 1.0f, DFA_HashDFAState, DFA_CompareDFAState);
+	
+	for (size_t i = 0; i < dfa->states.size; ++i)
+	{
+		HashTable_Insert(&stateToIndex, DFAStateVector_Get(&dfa->states, i), (void *)(i + 1));
+	}
+	
+	const char *prelude = "/* Generated by CLex */\n\
+\n\
+#pragma once\n\
+\n\
+#include <cstddef>\n\
+#include <cstdint>\n\
+#include <string_view>\n\
+\n\
+/* Tables are constexpr and scan is a template, so every call site compiles its own loop for its iterator\n\
+ * type. scan takes any iterators over bytes, such as those of std::string_view or std::span; it advances\n\
+ * first past the longest token, and past nothing if no token starts there. Needs C++17 */\n\
+namespace clex\n\
+{\n\
+\n";
+	fputs(prelude, output);
+	if (options->grammarHash)
+	{
+		fprintf(output, "inline constexpr std::uint64_t k_grammarHash = 0x%016llXull;\n\n", (unsigned long long)options->grammarHash);
+	}
+	fprintf(output, "enum class TokenType\n{\n\tCLex_Reject");
+	for (size_t i = 0; i < symbolsSize; ++i)
+	{
+		fprintf(output, ",\n\t%s", symbols[i].name);
+	}
+	fprintf(output, "\n};\n");
+	if (startsSize > 1)
+	{
+		fprintf(output, "\nenum class Mode\n{\n\t%s", modes[0]);
+		for (size_t i = 1; i < startsSize; ++i)
+		{
+			fprintf(output, ",\n\t%s", modes[i]);
+		}
+		fprintf(output, "\n};\n");
+	}
+	
+	const char *tokenStruct = "\n\
+struct Token\n\
+{\n\
+	TokenType type;\n\
+	std::size_t size;\n\
+};\n\
+\n\
+namespace detail\n\
+{\n\
+\n\
+inline constexpr TokenType k_types[] =\n\
+{\n\
+	TokenType::CLex_Reject";
+	fputs(tokenStruct, output);
+	for (size_t i = 0; i < dfa->states.size; ++i)
+	{
+		const DFAState *state = DFAStateVector_Get(&dfa->states, i);
+		fprintf(output, ",\n\tTokenType::%s", (state->symbol ? state->symbol : "CLex_Reject"));
+	}
+	
+	/* Rows hold the 128 ASCII edges in the narrowest type that fits every state index; trailing zeros are left out */
+	const char *edgeType = (dfa->states.size < 0x100 ? "std::uint8_t" : dfa->states.size < 0x10000 ? "std::uint16_t" : "std::uint32_t");
+	fprintf(output, "\n};\n\ninline constexpr %s k_edges[][128] =\n{\n\t{0}", edgeType);
+	for (size_t i = 0; i < dfa->states.size; ++i)
+	{
+		const DFAState *state = DFAStateVector_Get(&dfa->states, i);
+		int end = 1;
+		for (int c = 1; c < DFASTATE_EDGES_MAX; ++c)
+		{
+			if (state->edges[c])
+			{
+				end = c + 1;
+			}
+		}
+		
+		fprintf(output, ",\n\t{0");
+		for (int c = 1; c < end; ++c)
+		{
+			fprintf(output, ", %zu", Codegen_GetStateIndex(&stateToIndex, state->edges[c]));
+		}
+		fprintf(output, "}");
+	}
+	fprintf(output, "\n};\n\ninline constexpr std::size_t k_initialState = %zu;\n", Codegen_GetStateIndex(&stateToIndex, starts[0]));
+	if (startsSize > 1)
+	{
+		fprintf(output, "inline constexpr std::size_t k_initialStates[] = {%zu", Codegen_GetStateIndex(&stateToIndex, starts[0]));
+		for (size_t i = 1; i < startsSize; ++i)
+		{
+			fprintf(output, ", %zu", Codegen_GetStateIndex(&stateToIndex, starts[i]));
+		}
+		fprintf(output, "};\n");
+	}
+	if (keywordsSize)
+	{
+		Codegen_WriteCppKeywords(output, &keywordHash, keywords, keywordsSize);
+	}
+	
+	fprintf(output, "\ntemplate<class It>\nconstexpr Token scan(It &first, It last, std::size_t lastState)\n{\n");
+	if (keywordsSize)
+	{
+		fprintf(output, "\tchar token[k_keywordSizeMax] = {};\n");
+	}
+	const char *loopDefinition = "\
+	std::size_t size = 0;\n\
+	while (first != last)\n\
+	{\n\
+		unsigned char c = static_cast<unsigned char>(*first);\n\
+		std::size_t state = (c < 128 ? k_edges[lastState][c] : 0);\n\
+		if (!state)\n\
+		{\n\
+			break;\n\
+		}\n";
+	fputs(loopDefinition, output);
+	if (keywordsSize)
+	{
+		fprintf(output, "\t\tif (size < k_keywordSizeMax)\n\t\t{\n\t\t\ttoken[size] = static_cast<char>(c);\n\t\t}\n");
+	}
+	fprintf(output, "\t\t++first;\n\t\t++size;\n\t\tlastState = state;\n\t}\n");
+	if (keywordsSize)
+	{
+		fprintf(output, "\treturn {classify(k_types[lastState], token, size), size};\n}\n");
+	}
+	else
+	{
+		fprintf(output, "\treturn {k_types[lastState], size};\n}\n");
+	}
+	
+	const char *scanDefinition = "\n\
+}\n\
+\n\
+template<class It>\n\
+constexpr Token scan(It &first, It last)\n\
+{\n\
+	return detail::scan(first, last, detail::k_initialState);\n\
+}\n\
+\n\
+/* Scans the token at the start of input and removes it */\n\
+constexpr Token scan(std::string_view &input)\n\
+{\n\
+	const char *first = input.data();\n\
+	Token token = scan(first, input.data() + input.size());\n\
+	input.remove_prefix(token.size);\n\
+	return token;\n\
+}";
+	fputs(scanDefinition, output);
+	if (startsSize > 1)
+	{
+		const char *modeDefinition = "\n\
+\n\
+template<class It>\n\
+constexpr Token scan(It &first, It last, Mode mode)\n\
+{\n\
+	return detail::scan(first, last, detail::k_initialStates[static_cast<std::size_t>(mode)]);\n\
+}\n\
+\n\
+constexpr Token scan(std::string_view &input, Mode mode)\n\
+{\n\
+	const char *first = input.data();\n\
+	Token token = scan(first, input.data() + input.size(), mode);\n\
+	input.remove_prefix(token.size);\n\
+	return token;\n\
 }";
-	fprintf(output, clexDefinition);
+		fputs(modeDefinition, output);
+	}
+	fprintf(output, "\n\n}\n");
 	
 	HashTable_Destroy(&stateToIndex);
+	if (keywordsSize)
+	{
+		KeywordHash_Destroy(&keywordHash);
+	}
+	return true;
 }
\ No newline at end of file
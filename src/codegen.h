@@ -2,5 +2,59 @@
 
 #include "dfa.h"
 
-void Codegen_WriteHeader(FILE *output, const char **symbols, size_t symbolsSize);
-void Codegen_WriteSource(FILE *output, const DFA *dfa, const DFAState *start, const char *outputHeaderPath);
\ No newline at end of file
+#include <stdint.h>
+
+typedef struct CodegenOptions CodegenOptions;
+typedef struct CodegenKeyword CodegenKeyword;
+typedef enum CodegenValue CodegenValue;
+typedef struct CodegenSymbol CodegenSymbol;
+
+struct CodegenOptions
+{
+	bool push;
+	bool stream;
+	bool mmap;
+	bool parallel;
+	bool many;
+	bool stride2;
+	size_t stride2Limit;
+	bool incremental;
+	bool sync;
+	bool lines;
+	bool recover;
+	bool profile;
+	/* Written to the header as CLEX_GRAMMAR_HASH when not 0 */
+	uint64_t grammarHash;
+};
+struct CodegenKeyword
+{
+	const char *symbol;
+	const char *base;
+	const char *text;
+	size_t size;
+};
+enum CodegenValue
+{
+	CodegenValue_None,
+	CodegenValue_Decimal,
+	CodegenValue_Hex,
+	CodegenValue_Hash,
+	CodegenValue_Escapes
+};
+struct CodegenSymbol
+{
+	const char *name;
+	CodegenValue value;
+	bool intern;
+	/* The symbol's (?<name>...) groups are groups [groupsBegin, groupsBegin + groupsSize) of the grammar */
+	size_t groupsBegin;
+	size_t groupsSize;
+};
+
+void Codegen_WriteHeader(FILE *output, const CodegenOptions *options, const CodegenSymbol *symbols, size_t symbolsSize, const char **groups, const char **modes, size_t modesSize, const CodegenKeyword *keywords, size_t keywordsSize);
+bool Codegen_WriteSource(FILE *output, const CodegenOptions *options, const DFA *dfa, DFAState *const *starts, size_t startsSize, const CodegenSymbol *symbols, size_t symbolsSize, const CodegenKeyword *keywords, size_t keywordsSize, const char *outputHeaderPath);
+/* Writes a header-only C++17 scanner in namespace clex, with the token types, the modes and the keywords but
+ * none of the C entry points; returns false if there is no perfect hash for the keywords */
+bool Codegen_WriteCpp(FILE *output, const CodegenOptions *options, const DFA *dfa, DFAState *const *starts, size_t startsSize, const CodegenSymbol *symbols, size_t symbolsSize, const char **modes, const CodegenKeyword *keywords, size_t keywordsSize);
+/* Bytes of the transition tables Codegen_WriteSource emits, with the target's size_t as wide as the host's */
+size_t Codegen_GetTableSize(const CodegenOptions *options, const DFA *dfa);
\ No newline at end of file
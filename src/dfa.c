@@ -3,9 +3,13 @@
 #include "hash_set.h"
 #include "hash_table.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+VECTOR_DECLARE(DFAIndexVector, size_t, 0)
+VECTOR_DECLARE(NFAStateVector, NFAState *, 0)
+
 void DFAState_Initialize(DFAState *state)
 {
 	memset(state, 0, sizeof(DFAState));
@@ -14,21 +18,23 @@ void DFAState_Initialize(DFAState *state)
 void DFA_Create(DFA *dfa)
 {
 	StackAllocator_Create(&dfa->allocator, StackAllocator_DefaultGetNextCapacity);
-	Vector_Create(&dfa->states, 16);
+	DFAStateVector_Create(&dfa->states, NULL);
+	dfa->keysPeak = 0;
+	dfa->minimizedPeak = 0;
 }
 void DFA_Destroy(DFA *dfa)
 {
 	StackAllocator_Destroy(&dfa->allocator);
-	Vector_Destroy(&dfa->states);
+	DFAStateVector_Destroy(&dfa->states);
 }
 DFAState *DFA_AddState(DFA *dfa)
 {
 	DFAState *newState = StackAllocator_Allocate(&dfa->allocator, sizeof(DFAState));
 	DFAState_Initialize(newState);
-	Vector_Push(&dfa->states, newState);
+	DFAStateVector_Push(&dfa->states, newState);
 	return newState;
 }
-static void DFA_BuildEtaSet(NFAState *state, HashSet *set)
+static void DFA_BuildEtaSet(NFAState *state, HashSet *set, NFAStateVector *states)
 {
 	if (HashSet_Find(set, state))
 	{
@@ -36,26 +42,41 @@ static void DFA_BuildEtaSet(NFAState *state, HashSet *set)
 	}
 	
 	HashSet_Insert(set, state);
+	NFAStateVector_Push(states, state);
 	if (state->left.state && NFAEdgeConditions_Get(&state->left.conditions, 0))
 	{
-		DFA_BuildEtaSet(state->left.state, set);
+		DFA_BuildEtaSet(state->left.state, set, states);
 	}
 	if (state->right.state && NFAEdgeConditions_Get(&state->right.conditions, 0))
 	{
-		DFA_BuildEtaSet(state->right.state, set);
+		DFA_BuildEtaSet(state->right.state, set, states);
 	}
 }
-static void DFA_ComputeClosure(Vector *edge, HashSet *set)
+/* Appends the states in the closure of edge to states; set holds the states visited so far */
+static void DFA_ComputeClosure(const NFAStateVector *edge, HashSet *set, NFAStateVector *states)
 {
 	for (size_t i = 0; i < edge->size; ++i)
 	{
-		DFA_BuildEtaSet((NFAState *)Vector_Get(edge, i), set);
+		DFA_BuildEtaSet(NFAStateVector_Get(edge, i), set, states);
 	}
 }
+/* An NFA state in a DFA state, with the status of every tag on the paths that reach it: unset if
+ * no path entered the tag, start if it was entered before the first byte, diff if the paths disagree
+ * or the tag's register was overwritten since, and otherwise the value in the tag's register */
+typedef struct DFAThread
+{
+	NFAState *state;
+	size_t unset;
+	size_t start;
+	size_t diff;
+} DFAThread;
+VECTOR_DECLARE(DFAThreadVector, DFAThread, 0)
+VECTOR_DECLARE(DFAThreadOriginVector, const DFAThread *, 0)
 typedef struct DFAStateKey
 {
 	size_t size;
-	NFAState **states;
+	DFAThread *threads;
+	size_t tagsSet;
 } DFAStateKey;
 static size_t DFA_HashStateKey(const void *data)
 {
@@ -63,23 +84,26 @@ static size_t DFA_HashStateKey(const void *data)
 	size_t hash = 17;
 	for (size_t i = 0; i < key->size; ++i)
 	{
-		hash = hash * 37 + (size_t)key->states[i] * 2654435761;
+		hash = hash * 37 + (size_t)key->threads[i].state * 2654435761;
+		hash = hash * 37 + (key->threads[i].unset + key->threads[i].start * 3 + key->threads[i].diff * 5);
 	}
-	return hash;
+	return hash + key->tagsSet;
 }
 static bool DFA_CompareStateKey(const void *lhs, const void *rhs)
 {
 	const DFAStateKey *first = lhs;
 	const DFAStateKey *second = rhs;
 	
-	if (first->size != second->size)
+	if (first->size != second->size || first->tagsSet != second->tagsSet)
 	{
 		return false;
 	}
 	
 	for (size_t i = 0; i < first->size; ++i)
 	{
-		if (first->states[i] != second->states[i])
+		const DFAThread *a = &first->threads[i];
+		const DFAThread *b = &second->threads[i];
+		if (a->state != b->state || a->unset != b->unset || a->start != b->start || a->diff != b->diff)
 		{
 			return false;
 		}
@@ -95,10 +119,10 @@ static bool DFA_CompareNFAState(const void *lhs, const void *rhs)
 {
 	return lhs == rhs;
 }
-static int DFA_SortNFAState(const void *lhs, const void *rhs)
+static int DFA_SortDFAThread(const void *lhs, const void *rhs)
 {
-	NFAState *a = *(NFAState **)lhs;
-	NFAState *b = *(NFAState **)rhs;
+	NFAState *a = ((const DFAThread *)lhs)->state;
+	NFAState *b = ((const DFAThread *)rhs)->state;
 	
 	if (a < b)
 	{
@@ -110,54 +134,278 @@ static int DFA_SortNFAState(const void *lhs, const void *rhs)
 	}
 	return 0;
 }
-static DFAState *DFA_FromEntriesRecurse(DFA *dfa, DFAEntry *entries, size_t entriesSize, StackAllocator *allocator, HashTable *stateKeyToDFAState, Vector *edge)
+typedef struct DFATagPath
 {
-	/* Compute closure */
-	HashSet closure;
-	HashSet_Create(&closure, 16, 0.75f, DFA_HashNFAState, DFA_CompareNFAState);
-	DFA_ComputeClosure(edge, &closure);
+	NFAState *state;
+	size_t target;
+	size_t any;
+	size_t all;
+} DFATagPath;
+VECTOR_DECLARE(DFATagPathVector, DFATagPath, 0)
+/* Appends the states reachable from edge[target] over epsilon edges, with the tags entered on
+ * some path (any) and on every path (all) to each of them */
+static void DFA_BuildTagPaths(const NFAStateVector *edge, size_t target, StackAllocator *scratch, DFATagPathVector *paths)
+{
+	HashTable stateToPath;
+	HashTable_Create(&stateToPath, 16, 0.75f, DFA_HashNFAState, DFA_CompareNFAState);
+	DFAIndexVector stack;
+	DFAIndexVector_Create(&stack, scratch);
 	
+	NFAState *targetState = NFAStateVector_Get(edge, target);
+	DFATagPath targetPath = {targetState, target, targetState->tags, targetState->tags};
+	HashTable_Insert(&stateToPath, targetState, (void *)(paths->size + 1));
+	DFAIndexVector_Push(&stack, paths->size);
+	DFATagPathVector_Push(paths, targetPath);
+	
+	/* Masks only grow in any and shrink in all, so this settles even around epsilon loops */
+	while (stack.size)
+	{
+		size_t index = DFAIndexVector_Pop(&stack);
+		NFAEdge *edges[2] = {&paths->data[index].state->left, &paths->data[index].state->right};
+		for (int i = 0; i < 2; ++i)
+		{
+			NFAState *next = edges[i]->state;
+			if (!next || !NFAEdgeConditions_Get(&edges[i]->conditions, 0))
+			{
+				continue;
+			}
+			
+			size_t any = paths->data[index].any | next->tags;
+			size_t all = paths->data[index].all | next->tags;
+			void **found = HashTable_Find(&stateToPath, next);
+			if (!found)
+			{
+				DFATagPath nextPath = {next, target, any, all};
+				HashTable_Insert(&stateToPath, next, (void *)(paths->size + 1));
+				DFAIndexVector_Push(&stack, paths->size);
+				DFATagPathVector_Push(paths, nextPath);
+			}
+			else
+			{
+				DFATagPath *nextPath = &paths->data[(size_t)*found - 1];
+				if ((nextPath->any | any) != nextPath->any || (nextPath->all & all) != nextPath->all)
+				{
+					nextPath->any |= any;
+					nextPath->all &= all;
+					DFAIndexVector_Push(&stack, (size_t)*found - 1);
+				}
+			}
+		}
+	}
+	
+	DFAIndexVector_Destroy(&stack);
+	HashTable_Destroy(&stateToPath);
+}
+/* Computes the threads reached from the targets in edge, where origins holds the thread each target
+ * was reached from, or is empty for the initial state. Everything, threads included, is allocated in
+ * scratch */
+static void DFA_ComputeTaggedClosure(const NFAStateVector *edge, const DFAThreadOriginVector *origins, size_t tagsMask, StackAllocator *scratch, DFAThreadVector *threads, size_t *tagsSet)
+{
+	DFATagPathVector paths;
+	DFATagPathVector_Create(&paths, scratch);
+	for (size_t i = 0; i < edge->size; ++i)
+	{
+		DFA_BuildTagPaths(edge, i, scratch, &paths);
+	}
+	
+	/* Every tag entered on any path is written to its register */
+	*tagsSet = 0;
+	if (origins->size)
+	{
+		for (size_t i = 0; i < paths.size; ++i)
+		{
+			*tagsSet |= paths.data[i].any;
+		}
+	}
+	
+	HashTable stateToThread;
+	HashTable_Create(&stateToThread, 16, 0.75f, DFA_HashNFAState, DFA_CompareNFAState);
+	for (size_t i = 0; i < paths.size; ++i)
+	{
+		const DFATagPath *path = &paths.data[i];
+		size_t some = path->any & ~path->all;
+		DFAThread thread;
+		thread.state = path->state;
+		if (origins->size)
+		{
+			const DFAThread *origin = DFAThreadOriginVector_Get(origins, path->target);
+			size_t synced = ~origin->unset & ~origin->start & ~origin->diff;
+			thread.unset = origin->unset & ~path->any;
+			thread.start = origin->start & ~path->any;
+			thread.diff = some | (~path->any & (origin->diff | (*tagsSet & synced)));
+		}
+		else
+		{
+			thread.unset = tagsMask & ~path->any;
+			thread.start = path->all;
+			thread.diff = some;
+		}
+		
+		void **found = HashTable_Find(&stateToThread, thread.state);
+		if (!found)
+		{
+			HashTable_Insert(&stateToThread, thread.state, (void *)(threads->size + 1));
+			DFAThreadVector_Push(threads, thread);
+		}
+		else
+		{
+			/* Threads that meet with different statuses no longer know their tags */
+			DFAThread *other = &threads->data[(size_t)*found - 1];
+			size_t differ = (other->unset ^ thread.unset) | (other->start ^ thread.start) | (other->diff ^ thread.diff);
+			other->diff |= thread.diff | differ;
+			other->unset &= ~differ;
+			other->start &= ~differ;
+		}
+	}
+	
+	HashTable_Destroy(&stateToThread);
+	DFATagPathVector_Destroy(&paths);
+}
+static const DFAThread *DFA_FindThread(const DFAStateKey *key, const NFAState *state)
+{
+	DFAThread thread = {(NFAState *)state, 0, 0, 0};
+	return bsearch(&thread, key->threads, key->size, sizeof(DFAThread), DFA_SortDFAThread);
+}
+/* A state whose transitions are not built yet, with the key it was found by */
+typedef struct DFAPendingState
+{
+	DFAState *state;
+	const DFAStateKey *key;
+} DFAPendingState;
+VECTOR_DECLARE(DFAPendingStateVector, DFAPendingState, 0)
+/* Returns the state for the NFA states on edge. A state that is new is added to pending, for its transitions
+ * to be built later. The closure is computed in closure and scratch, which every call shares and leaves empty */
+static DFAState *DFA_FindOrAddState(DFA *dfa, DFAEntry *entries, size_t entriesSize, size_t tagsMask, StackAllocator *allocator, HashTable *stateKeyToDFAState, const NFAStateVector *edge, const DFAThreadOriginVector *origins, HashSet *closure, StackAllocator *scratch, DFAPendingStateVector *pending)
+{
 	/* Make key */
+	StackAllocatorMark mark = StackAllocator_Mark(allocator);
+	StackAllocatorMark scratchMark = StackAllocator_Mark(scratch);
 	DFAStateKey *key = StackAllocator_Allocate(allocator, sizeof(DFAStateKey));
-	key->size = closure.size;
-	key->states = StackAllocator_Allocate(allocator, key->size * sizeof(NFAState *));
-	HashSet_ToArray(&closure, key->states);
-	qsort(key->states, key->size, sizeof(NFAState *), DFA_SortNFAState);
+	key->tagsSet = 0;
+	if (!tagsMask)
+	{
+		/* Compute closure */
+		NFAStateVector states;
+		NFAStateVector_Create(&states, scratch);
+		HashSet_Clear(closure);
+		DFA_ComputeClosure(edge, closure, &states);
+		key->size = states.size;
+		key->threads = StackAllocator_Allocate(allocator, key->size * sizeof(DFAThread));
+		for (size_t i = 0; i < key->size; ++i)
+		{
+			DFAThread thread = {NFAStateVector_Get(&states, i), 0, 0, 0};
+			key->threads[i] = thread;
+		}
+		NFAStateVector_Destroy(&states);
+	}
+	else
+	{
+		/* Compute closure, tracking the tags on every path */
+		DFAThreadVector threads;
+		DFAThreadVector_Create(&threads, scratch);
+		DFA_ComputeTaggedClosure(edge, origins, tagsMask, scratch, &threads, &key->tagsSet);
+		key->size = threads.size;
+		key->threads = StackAllocator_Allocate(allocator, key->size * sizeof(DFAThread));
+		memcpy(key->threads, threads.data, key->size * sizeof(DFAThread));
+		DFAThreadVector_Destroy(&threads);
+	}
+	StackAllocator_Rewind(scratch, scratchMark);
+	qsort(key->threads, key->size, sizeof(DFAThread), DFA_SortDFAThread);
 	
 	/* Look up state */
-	DFAState *state = NULL;
+	void **statePtr = HashTable_Find(stateKeyToDFAState, key);
+	if (statePtr)
+	{
+		/* Release key, even when it spans two blocks */
+		StackAllocator_Rewind(allocator, mark);
+		return *statePtr;
+	}
+	
+	/* Insert new state */
+	DFAState *state = DFA_AddState(dfa);
+	DFAState_Initialize(state);
+	HashTable_Insert(stateKeyToDFAState, key, state);
+	state->tagsSet = key->tagsSet;
+	
+	/* Determine symbol, and where its tags are when the token ends here */
+	for (size_t i = 0; i < entriesSize; ++i)
 	{
-		void **statePtr = HashTable_Find(stateKeyToDFAState, key);
-		if (statePtr)
+		const DFAThread *end = DFA_FindThread(key, entries[i].expression.end);
+		if (end)
 		{
-			state = *statePtr;
+			state->symbol = entries[i].symbol;
+			state->tagsUnset = end->unset & entries[i].tags;
+			state->tagsStart = end->start & entries[i].tags;
+			state->tagsAmbiguous = end->diff & entries[i].tags;
+			break;
 		}
 	}
 	
-	if (!state)
+	DFAPendingState newPending = {state, key};
+	DFAPendingStateVector_Push(pending, newPending);
+	return state;
+}
+void DFA_FromEntries(DFA *dfa, DFAEntry *entries, size_t entriesSize, DFAState **starts, size_t modesSize)
+{
+	/* Allocator */
+	StackAllocator allocator;
+	StackAllocator_Create(&allocator, StackAllocator_DefaultGetNextCapacity);
+	
+	/* Hash table from DFAStateKey * to DFAState * */
+	HashTable stateKeyToDFAState;
+	HashTable_Create(&stateKeyToDFAState, 16, 0.75f, DFA_HashStateKey, DFA_CompareStateKey);
+	
+	/* The NFA states on an edge, and the thread each was reached from */
+	NFAStateVector edge;
+	NFAStateVector_Create(&edge, NULL);
+	DFAThreadOriginVector origins;
+	DFAThreadOriginVector_Create(&origins, NULL);
+	
+	/* The closure of an edge, and the temporaries of computing it */
+	HashSet closure;
+	HashSet_Create(&closure, 16, 0.75f, DFA_HashNFAState, DFA_CompareNFAState);
+	StackAllocator scratch;
+	StackAllocator_Create(&scratch, StackAllocator_DefaultGetNextCapacity);
+	
+	/* States are built from a worklist rather than by recursion, so that the number of states is not
+	 * limited by the stack */
+	DFAPendingStateVector pending;
+	DFAPendingStateVector_Create(&pending, NULL);
+	
+	size_t tagsMask = 0;
+	for (size_t i = 0; i < entriesSize; ++i)
 	{
-		/* Insert new state */
-		state = DFA_AddState(dfa);
-		DFAState_Initialize(state);
-		HashTable_Insert(stateKeyToDFAState, key, state);
-		
-		/* Determine symbol */
+		tagsMask |= entries[i].tags;
+	}
+	
+	/* Initial states, one per mode; modes share every state they have in common */
+	for (size_t mode = 0; mode < modesSize; ++mode)
+	{
+		NFAStateVector_Clear(&edge);
+		DFAThreadOriginVector_Clear(&origins);
 		for (size_t i = 0; i < entriesSize; ++i)
 		{
-			if (HashSet_Find(&closure, entries[i].expression.end))
+			if (entries[i].modes & ((size_t)1 << mode))
 			{
-				state->symbol = entries[i].symbol;
-				break;
+				NFAStateVector_Push(&edge, entries[i].expression.start);
 			}
 		}
-
+		
+		starts[mode] = DFA_FindOrAddState(dfa, entries, entriesSize, tagsMask, &allocator, &stateKeyToDFAState, &edge, &origins, &closure, &scratch, &pending);
+	}
+	
+	while (pending.size)
+	{
+		DFAPendingState next = DFAPendingStateVector_Pop(&pending);
+		const DFAStateKey *key = next.key;
+		
 		/* Collect transitions */
 		NFAEdgeConditions conditions;
 		memset(&conditions, 0, sizeof(NFAEdgeConditions));
 		for (size_t i = 0; i < key->size; ++i)
 		{
-			NFAEdgeConditions_Or(&conditions, &key->states[i]->left.conditions);
-			NFAEdgeConditions_Or(&conditions, &key->states[i]->right.conditions);
+			NFAEdgeConditions_Or(&conditions, &key->threads[i].state->left.conditions);
+			NFAEdgeConditions_Or(&conditions, &key->threads[i].state->right.conditions);
 		}
 		
 		/* Perform transitions */
@@ -166,64 +414,41 @@ static DFAState *DFA_FromEntriesRecurse(DFA *dfa, DFAEntry *entries, size_t entr
 			if (NFAEdgeConditions_Get(&conditions, c))
 			{
 				/* Build edge */
-				Vector_Clear(edge);
+				NFAStateVector_Clear(&edge);
+				DFAThreadOriginVector_Clear(&origins);
 				for (size_t i = 0; i < key->size; ++i)
 				{
-					if (NFAEdgeConditions_Get(&key->states[i]->left.conditions, c))
+					NFAState *from = key->threads[i].state;
+					if (NFAEdgeConditions_Get(&from->left.conditions, c))
 					{
-						Vector_Push(edge, key->states[i]->left.state);
+						NFAStateVector_Push(&edge, from->left.state);
+						DFAThreadOriginVector_Push(&origins, &key->threads[i]);
 					}
-					if (NFAEdgeConditions_Get(&key->states[i]->right.conditions, c))
+					if (NFAEdgeConditions_Get(&from->right.conditions, c))
 					{
-						Vector_Push(edge, key->states[i]->right.state);
+						NFAStateVector_Push(&edge, from->right.state);
+						DFAThreadOriginVector_Push(&origins, &key->threads[i]);
 					}
 				}
 				
-				/* Recurse */
-				state->edges[c] = DFA_FromEntriesRecurse(dfa, entries, entriesSize, allocator, stateKeyToDFAState, edge);
+				next.state->edges[c] = DFA_FindOrAddState(dfa, entries, entriesSize, tagsMask, &allocator, &stateKeyToDFAState, &edge, &origins, &closure, &scratch, &pending);
 			}
 		}
 	}
-	else
-	{
-		/* Release key */
-		StackAllocator_Free(allocator, key->size * sizeof(NFAState *));
-		StackAllocator_Free(allocator, sizeof(DFAStateKey));
-	}
-
-	/* Clean up */
-	HashSet_Destroy(&closure);
-	
-	return state;
-}
-DFAState *DFA_FromEntries(DFA *dfa, DFAEntry *entries, size_t entriesSize)
-{
-	/* Allocator */
-	StackAllocator allocator;
-	StackAllocator_Create(&allocator, StackAllocator_DefaultGetNextCapacity);
-	
-	/* Hash table from DFAStateKey * to DFAState * */
-	HashTable stateKeyToDFAState;
-	HashTable_Create(&stateKeyToDFAState, 16, 0.75f, DFA_HashStateKey, DFA_CompareStateKey);
-	
-	/* Vector of NFAState * */
-	Vector edge;
-	Vector_Create(&edge, 16);
-	
-	/* Initial States */
-	for (size_t i = 0; i < entriesSize; ++i)
-	{
-		Vector_Push(&edge, entries[i].expression.start);
-	}
-	
-	DFAState *start = DFA_FromEntriesRecurse(dfa, entries, entriesSize, &allocator, &stateKeyToDFAState, &edge);
 	
 	/* Clean up */
+	dfa->keysPeak = allocator.peak;
 	StackAllocator_Destroy(&allocator);
 	HashTable_Destroy(&stateKeyToDFAState);
-	Vector_Destroy(&edge);
-	
-	return start;
+	NFAStateVector_Destroy(&edge);
+	DFAThreadOriginVector_Destroy(&origins);
+	HashSet_Destroy(&closure);
+	StackAllocator_Destroy(&scratch);
+	DFAPendingStateVector_Destroy(&pending);
+}
+static int DFA_CompareSize(size_t a, size_t b)
+{
+	return (a < b ? -1 : a > b ? 1 : 0);
 }
 static int DFA_SortDFAStateBySymbol(const void *lhs, const void *rhs)
 {
@@ -238,7 +463,13 @@ static int DFA_SortDFAStateBySymbol(const void *lhs, const void *rhs)
 	{
 		return 1;
 	}
-	return 0;
+	
+	/* States that handle tags differently are never equivalent */
+	int result = DFA_CompareSize(a->tagsSet, b->tagsSet);
+	result = (result ? result : DFA_CompareSize(a->tagsUnset, b->tagsUnset));
+	result = (result ? result : DFA_CompareSize(a->tagsStart, b->tagsStart));
+	result = (result ? result : DFA_CompareSize(a->tagsAmbiguous, b->tagsAmbiguous));
+	return result;
 }
 static size_t DFA_HashDFAState(const void *data)
 {
@@ -256,16 +487,16 @@ static bool DFA_CompareSizeT(const void *lhs, const void *rhs)
 {
 	return (size_t)lhs == (size_t)rhs;
 }
-DFAState *DFA_Minimize(DFA *dfa, DFAState *start)
+void DFA_Minimize(DFA *dfa, DFAState **starts, size_t startsSize)
 {
 	if (dfa->states.size == 0)
 	{
-		return start;
+		return;
 	}
 	
 	/* Partitions */
-	Vector partitions;
-	Vector_Create(&partitions, 16);
+	DFAIndexVector partitions;
+	DFAIndexVector_Create(&partitions, NULL);
 	
 	/* State to partition leader*/
 	HashTable stateToPartitionLeader;
@@ -277,18 +508,18 @@ DFAState *DFA_Minimize(DFA *dfa, DFAState *start)
 	/* Build initial partitions */
 	{
 		size_t partitionLeader = 0;
-		Vector_Push(&partitions, (void *)partitionLeader);
+		DFAIndexVector_Push(&partitions, partitionLeader);
 		
-		DFAState *lastState = Vector_Get(&dfa->states, 0);
+		DFAState *lastState = DFAStateVector_Get(&dfa->states, 0);
 		HashTable_Insert(&stateToPartitionLeader, lastState, (void *)partitionLeader);
 		
 		for (size_t i = 1; i < dfa->states.size; ++i)
 		{
-			DFAState *nextState = Vector_Get(&dfa->states, i);
-			if (lastState->symbol != nextState->symbol)
+			DFAState *nextState = DFAStateVector_Get(&dfa->states, i);
+			if (DFA_SortDFAStateBySymbol(&lastState, &nextState))
 			{
 				partitionLeader = i;
-				Vector_Push(&partitions, (void *)partitionLeader);
+				DFAIndexVector_Push(&partitions, partitionLeader);
 			}
 			HashTable_Insert(&stateToPartitionLeader, nextState, (void *)partitionLeader);
 			lastState = nextState;
@@ -297,8 +528,9 @@ DFAState *DFA_Minimize(DFA *dfa, DFAState *start)
 	
 	/* Refine partitions */
 	{
-		Vector newPartitions;
-		Vector_Create(&newPartitions, partitions.size);
+		DFAIndexVector newPartitions;
+		DFAIndexVector_Create(&newPartitions, NULL);
+		DFAIndexVector_Reserve(&newPartitions, partitions.size);
 		
 		bool done = false;
 		while (!done)
@@ -308,15 +540,15 @@ DFAState *DFA_Minimize(DFA *dfa, DFAState *start)
 			/* Start building new partitions */
 			for (size_t i = 0; i < partitions.size; ++i)
 			{
-				size_t partitionBegin = (size_t)Vector_Get(&partitions, i);
-				size_t partitionEnd = (i < partitions.size - 1 ? (size_t)Vector_Get(&partitions, i + 1) : dfa->states.size);
+				size_t partitionBegin = DFAIndexVector_Get(&partitions, i);
+				size_t partitionEnd = (i < partitions.size - 1 ? DFAIndexVector_Get(&partitions, i + 1) : dfa->states.size);
 				size_t newPartitionBegin = partitionEnd;
 				
 				/* Add current partition */
-				Vector_Push(&newPartitions, (void *)partitionBegin);
+				DFAIndexVector_Push(&newPartitions, partitionBegin);
 				
 				/* Run through the alphabet and stop if we run out of non-leader states in the partition */
-				DFAState *leader = Vector_Get(&dfa->states, partitionBegin);
+				DFAState *leader = DFAStateVector_Get(&dfa->states, partitionBegin);
 				for (int c = 0; c < DFASTATE_EDGES_MAX && partitionBegin + 1 < newPartitionBegin; ++c)
 				{
 					/* Get leader's next partition for the current character */
@@ -335,7 +567,7 @@ DFAState *DFA_Minimize(DFA *dfa, DFAState *start)
 					for (size_t j = partitionBegin + 1; j < newPartitionBegin; ++j)
 					{
 						/* Get the state's next partition for the current character */
-						DFAState *state = Vector_Get(&dfa->states, j);
+						DFAState *state = DFAStateVector_Get(&dfa->states, j);
 						DFAState *stateNext = state->edges[c];
 						size_t stateNextPartition;
 						if (!stateNext)
@@ -351,9 +583,9 @@ DFAState *DFA_Minimize(DFA *dfa, DFAState *start)
 						if (leaderNextPartition != stateNextPartition)
 						{
 							--newPartitionBegin;
-							DFAState *temp = Vector_Get(&dfa->states, newPartitionBegin);
-							Vector_Set(&dfa->states, newPartitionBegin, state);
-							Vector_Set(&dfa->states, j, temp);
+							DFAState *temp = DFAStateVector_Get(&dfa->states, newPartitionBegin);
+							DFAStateVector_Set(&dfa->states, newPartitionBegin, state);
+							DFAStateVector_Set(&dfa->states, j, temp);
 							--j;
 						}
 					}
@@ -363,7 +595,7 @@ DFAState *DFA_Minimize(DFA *dfa, DFAState *start)
 				if (newPartitionBegin != partitionEnd)
 				{
 					done = false;
-					Vector_Push(&newPartitions, (void *)newPartitionBegin);
+					DFAIndexVector_Push(&newPartitions, newPartitionBegin);
 				}
 			}
 			
@@ -372,36 +604,35 @@ DFAState *DFA_Minimize(DFA *dfa, DFAState *start)
 			{
 				for (size_t i = 1, j = 1; j < newPartitions.size; ++i, ++j)
 				{
-					size_t partitionLeader = (i < partitions.size ? (size_t)Vector_Get(&partitions, i) : partitions.size);
-					size_t newPartitionLeader = (size_t)Vector_Get(&newPartitions, j);
+					size_t partitionLeader = (i < partitions.size ? DFAIndexVector_Get(&partitions, i) : partitions.size);
+					size_t newPartitionLeader = DFAIndexVector_Get(&newPartitions, j);
 					if (partitionLeader != newPartitionLeader)
 					{
 						for (size_t k = newPartitionLeader; k < partitionLeader; k++)
 						{
-							DFAState *state = Vector_Get(&dfa->states, k);
+							DFAState *state = DFAStateVector_Get(&dfa->states, k);
 							*(size_t *)HashTable_Find(&stateToPartitionLeader, state) = newPartitionLeader;
 						}
 						++j;
 					}
 				}
-
+				
 				/* Swap partitions with new partitions */
-				Vector temp = partitions;
-				partitions = newPartitions;
-				newPartitions = temp;
-				Vector_Clear(&newPartitions);
+				DFAIndexVector_Swap(&partitions, &newPartitions);
+				DFAIndexVector_Clear(&newPartitions);
 			}
 		}
 		
-		Vector_Destroy(&newPartitions);
+		DFAIndexVector_Destroy(&newPartitions);
 	}
 	
 	/* Build new states */
 	StackAllocator newAllocator;
 	StackAllocator_Create(&newAllocator, StackAllocator_DefaultGetNextCapacity);
 	
-	Vector newStates;
-	Vector_Create(&newStates, partitions.size);
+	DFAStateVector newStates;
+	DFAStateVector_Create(&newStates, NULL);
+	DFAStateVector_Reserve(&newStates, partitions.size);
 	
 	HashTable partitionLeaderToNewState;
 	HashTable_Create(&partitionLeaderToNewState, partitions.size + partitions.size / 2, 1.0f, DFA_HashSizeT, DFA_CompareSizeT);
@@ -409,16 +640,20 @@ DFAState *DFA_Minimize(DFA *dfa, DFAState *start)
 	for (size_t i = 0; i < partitions.size; ++i)
 	{
 		DFAState *newState = StackAllocator_Allocate(&newAllocator, sizeof(DFAState));
-		HashTable_Insert(&partitionLeaderToNewState, Vector_Get(&partitions, i), newState);
-		Vector_Push(&newStates, newState);
+		HashTable_Insert(&partitionLeaderToNewState, (void *)DFAIndexVector_Get(&partitions, i), newState);
+		DFAStateVector_Push(&newStates, newState);
 	}
 	
 	for (size_t i = 0; i < partitions.size; ++i)
 	{
-		size_t partitionLeader = (size_t)Vector_Get(&partitions, i);
-		DFAState *leader = Vector_Get(&dfa->states, partitionLeader);
+		size_t partitionLeader = DFAIndexVector_Get(&partitions, i);
+		DFAState *leader = DFAStateVector_Get(&dfa->states, partitionLeader);
 		DFAState *newState = *HashTable_Find(&partitionLeaderToNewState, (void *)partitionLeader);
 		newState->symbol = leader->symbol;
+		newState->tagsSet = leader->tagsSet;
+		newState->tagsUnset = leader->tagsUnset;
+		newState->tagsStart = leader->tagsStart;
+		newState->tagsAmbiguous = leader->tagsAmbiguous;
 		
 		for (int c = 0; c < DFASTATE_EDGES_MAX; ++c)
 		{
@@ -433,19 +668,312 @@ DFAState *DFA_Minimize(DFA *dfa, DFAState *start)
 		}
 	}
 	
-	/* Find new start */
-	DFAState *newStart = *HashTable_Find(&partitionLeaderToNewState, *HashTable_Find(&stateToPartitionLeader, start));
+	/* Find new starts */
+	for (size_t i = 0; i < startsSize; ++i)
+	{
+		starts[i] = *HashTable_Find(&partitionLeaderToNewState, *HashTable_Find(&stateToPartitionLeader, starts[i]));
+	}
 	
 	/* Clean up */
-	Vector_Destroy(&partitions);
+	DFAIndexVector_Destroy(&partitions);
 	HashTable_Destroy(&stateToPartitionLeader);
 	HashTable_Destroy(&partitionLeaderToNewState);
 	
 	/* Swap storage */
+	dfa->minimizedPeak = newAllocator.peak;
 	StackAllocator_Destroy(&dfa->allocator);
 	dfa->allocator = newAllocator;
-	Vector_Destroy(&dfa->states);
-	dfa->states = newStates;
+	DFAStateVector_Swap(&dfa->states, &newStates);
+	DFAStateVector_Destroy(&newStates);
+	
+	/* The partitions come out in the order of symbol pointers; number the states by the automaton alone */
+	DFA_Reorder(dfa, starts, startsSize, NULL);
+}
+typedef struct DFARank DFARank;
+struct DFARank
+{
+	size_t weight;
+	size_t rank;
+	DFAState *state;
+};
+static int DFA_SortRank(const void *lhs, const void *rhs)
+{
+	const DFARank *a = lhs;
+	const DFARank *b = rhs;
+	
+	if (a->weight != b->weight)
+	{
+		return (a->weight > b->weight ? -1 : 1);
+	}
+	return (a->rank < b->rank ? -1 : a->rank > b->rank);
+}
+static HashTable DFA_IndexStates(const DFA *dfa)
+{
+	/* Hash table from DFAState * to its index plus one */
+	HashTable stateToIndex;
+	HashTable_Create(&stateToIndex, dfa->states.size + dfa->states.size / 2, 1.0f, DFA_HashDFAState, DFA_CompareDFAState);
+	for (size_t i = 0; i < dfa->states.size; ++i)
+	{
+		HashTable_Insert(&stateToIndex, DFAStateVector_Get(&dfa->states, i), (void *)(i + 1));
+	}
+	return stateToIndex;
+}
+void DFA_Reorder(DFA *dfa, DFAState *const *starts, size_t startsSize, const size_t *weights)
+{
+	if (dfa->states.size == 0)
+	{
+		return;
+	}
 	
-	return newStart;
+	HashTable stateToIndex = DFA_IndexStates(dfa);
+	DFARank *ranks = malloc(dfa->states.size * sizeof(DFARank));
+	bool *visited = calloc(dfa->states.size, sizeof(bool));
+	size_t ranksSize = 0;
+	
+	/* Breadth-first from the starts, following edges in byte order */
+	for (size_t i = 0; i < startsSize; ++i)
+	{
+		size_t index = (size_t)*HashTable_Find(&stateToIndex, starts[i]) - 1;
+		if (!visited[index])
+		{
+			visited[index] = true;
+			ranks[ranksSize++].state = starts[i];
+		}
+	}
+	for (size_t head = 0; head < ranksSize; ++head)
+	{
+		const DFAState *state = ranks[head].state;
+		for (int c = 0; c < DFASTATE_EDGES_MAX; ++c)
+		{
+			if (state->edges[c])
+			{
+				size_t index = (size_t)*HashTable_Find(&stateToIndex, state->edges[c]) - 1;
+				if (!visited[index])
+				{
+					visited[index] = true;
+					ranks[ranksSize++].state = state->edges[c];
+				}
+			}
+		}
+	}
+	
+	/* States no start reaches keep their order at the end */
+	for (size_t i = 0; i < dfa->states.size; ++i)
+	{
+		if (!visited[i])
+		{
+			ranks[ranksSize++].state = DFAStateVector_Get(&dfa->states, i);
+		}
+	}
+	
+	for (size_t i = 0; i < ranksSize; ++i)
+	{
+		ranks[i].rank = i;
+		ranks[i].weight = (weights ? weights[(size_t)*HashTable_Find(&stateToIndex, ranks[i].state) - 1] : 0);
+	}
+	if (weights)
+	{
+		qsort(ranks, ranksSize, sizeof(DFARank), DFA_SortRank);
+	}
+	for (size_t i = 0; i < ranksSize; ++i)
+	{
+		DFAStateVector_Set(&dfa->states, i, ranks[i].state);
+	}
+	
+	/* Clean up */
+	HashTable_Destroy(&stateToIndex);
+	free(ranks);
+	free(visited);
+}
+void DFA_CountTransitions(const DFA *dfa, const DFAState *start, const char *input, size_t inputSize, size_t *counts)
+{
+	if (dfa->states.size == 0)
+	{
+		return;
+	}
+	
+	/* Dense table of next state indices, with dfa->states.size for none */
+	HashTable stateToIndex = DFA_IndexStates(dfa);
+	size_t *next = malloc(dfa->states.size * DFASTATE_EDGES_MAX * sizeof(size_t));
+	for (size_t i = 0; i < dfa->states.size; ++i)
+	{
+		const DFAState *state = DFAStateVector_Get(&dfa->states, i);
+		for (int c = 0; c < DFASTATE_EDGES_MAX; ++c)
+		{
+			next[i * DFASTATE_EDGES_MAX + c] = (state->edges[c] ? (size_t)*HashTable_Find(&stateToIndex, state->edges[c]) - 1 : dfa->states.size);
+		}
+	}
+	size_t startIndex = (size_t)*HashTable_Find(&stateToIndex, start) - 1;
+	
+	size_t state = startIndex;
+	for (size_t i = 0; i < inputSize; )
+	{
+		unsigned char c = (unsigned char)input[i];
+		size_t nextState = (c < DFASTATE_EDGES_MAX ? next[state * DFASTATE_EDGES_MAX + c] : dfa->states.size);
+		if (nextState != dfa->states.size)
+		{
+			++counts[state];
+			state = nextState;
+			++i;
+		}
+		else
+		{
+			/* The token ends here; a token that ends before its first byte is rejected and skipped */
+			i += (state == startIndex);
+			state = startIndex;
+		}
+	}
+	
+	/* Clean up */
+	HashTable_Destroy(&stateToIndex);
+	free(next);
+}
+static void DFA_WriteInteger(FILE *output, uint64_t value, size_t size)
+{
+	unsigned char bytes[8];
+	for (size_t i = 0; i < size; ++i)
+	{
+		bytes[i] = (unsigned char)(value >> (8 * i));
+	}
+	fwrite(bytes, 1, size, output);
+}
+static bool DFA_ReadInteger(FILE *input, uint64_t *value, size_t size)
+{
+	unsigned char bytes[8];
+	if (fread(bytes, 1, size, input) != size)
+	{
+		return false;
+	}
+	*value = 0;
+	for (size_t i = 0; i < size; ++i)
+	{
+		*value |= (uint64_t)bytes[i] << (8 * i);
+	}
+	return true;
+}
+void DFA_Save(const DFA *dfa, DFAState *const *starts, size_t startsSize, const DFAEntry *entries, size_t entriesSize, FILE *output)
+{
+	HashTable stateToIndex = DFA_IndexStates(dfa);
+	
+	DFA_WriteInteger(output, dfa->states.size, 4);
+	for (size_t i = 0; i < startsSize; ++i)
+	{
+		DFA_WriteInteger(output, (size_t)*HashTable_Find(&stateToIndex, starts[i]) - 1, 4);
+	}
+	for (size_t i = 0; i < dfa->states.size; ++i)
+	{
+		const DFAState *state = DFAStateVector_Get(&dfa->states, i);
+		size_t symbol = 0;
+		for (size_t j = 0; j < entriesSize && !symbol && state->symbol; ++j)
+		{
+			symbol = (entries[j].symbol == state->symbol ? j + 1 : 0);
+		}
+		DFA_WriteInteger(output, symbol, 4);
+		DFA_WriteInteger(output, state->tagsSet, 8);
+		DFA_WriteInteger(output, state->tagsUnset, 8);
+		DFA_WriteInteger(output, state->tagsStart, 8);
+		DFA_WriteInteger(output, state->tagsAmbiguous, 8);
+		
+		size_t edgesSize = 0;
+		for (int c = 0; c < DFASTATE_EDGES_MAX; ++c)
+		{
+			edgesSize += (state->edges[c] != NULL);
+		}
+		DFA_WriteInteger(output, edgesSize, 1);
+		for (int c = 0; c < DFASTATE_EDGES_MAX; ++c)
+		{
+			if (state->edges[c])
+			{
+				DFA_WriteInteger(output, c, 1);
+				DFA_WriteInteger(output, (size_t)*HashTable_Find(&stateToIndex, state->edges[c]) - 1, 4);
+			}
+		}
+	}
+	
+	HashTable_Destroy(&stateToIndex);
+}
+bool DFA_Load(DFA *dfa, DFAState **starts, size_t startsSize, const DFAEntry *entries, size_t entriesSize, FILE *input)
+{
+	/* A state takes at least 37 bytes, which bounds the count before anything is allocated */
+	long begin = ftell(input);
+	fseek(input, 0, SEEK_END);
+	uint64_t remaining = (uint64_t)(ftell(input) - begin);
+	fseek(input, begin, SEEK_SET);
+	
+	uint64_t statesSize;
+	if (!DFA_ReadInteger(input, &statesSize, 4) || !statesSize || statesSize * 37 > remaining)
+	{
+		return false;
+	}
+	for (uint64_t i = 0; i < statesSize; ++i)
+	{
+		DFA_AddState(dfa);
+	}
+	for (size_t i = 0; i < startsSize; ++i)
+	{
+		uint64_t start;
+		if (!DFA_ReadInteger(input, &start, 4) || start >= statesSize)
+		{
+			return false;
+		}
+		starts[i] = DFAStateVector_Get(&dfa->states, (size_t)start);
+	}
+	for (size_t i = 0; i < dfa->states.size; ++i)
+	{
+		DFAState *state = DFAStateVector_Get(&dfa->states, i);
+		uint64_t symbol, tagsSet, tagsUnset, tagsStart, tagsAmbiguous, edgesSize;
+		bool read = DFA_ReadInteger(input, &symbol, 4) && DFA_ReadInteger(input, &tagsSet, 8) && DFA_ReadInteger(input, &tagsUnset, 8) &&
+			DFA_ReadInteger(input, &tagsStart, 8) && DFA_ReadInteger(input, &tagsAmbiguous, 8) && DFA_ReadInteger(input, &edgesSize, 1);
+		if (!read || symbol > entriesSize)
+		{
+			return false;
+		}
+		state->symbol = (symbol ? entries[symbol - 1].symbol : NULL);
+		state->tagsSet = (size_t)tagsSet;
+		state->tagsUnset = (size_t)tagsUnset;
+		state->tagsStart = (size_t)tagsStart;
+		state->tagsAmbiguous = (size_t)tagsAmbiguous;
+		
+		for (uint64_t j = 0; j < edgesSize; ++j)
+		{
+			uint64_t c, target;
+			if (!DFA_ReadInteger(input, &c, 1) || !DFA_ReadInteger(input, &target, 4) || c >= DFASTATE_EDGES_MAX || target >= statesSize)
+			{
+				return false;
+			}
+			state->edges[c] = DFAStateVector_Get(&dfa->states, (size_t)target);
+		}
+	}
+	return true;
+}
+size_t DFA_ComputeByteClasses(const DFA *dfa, unsigned char classes[DFASTATE_EDGES_MAX])
+{
+	/* Bytes are in the same class if every state sends them to the same place */
+	int representatives[DFASTATE_EDGES_MAX];
+	size_t classesSize = 0;
+	for (int c = 0; c < DFASTATE_EDGES_MAX; ++c)
+	{
+		size_t j = 0;
+		for (; j < classesSize; ++j)
+		{
+			bool same = true;
+			for (size_t i = 0; i < dfa->states.size && same; ++i)
+			{
+				const DFAState *state = DFAStateVector_Get(&dfa->states, i);
+				same = (state->edges[c] == state->edges[representatives[j]]);
+			}
+			if (same)
+			{
+				break;
+			}
+		}
+		
+		if (j == classesSize)
+		{
+			representatives[classesSize] = c;
+			++classesSize;
+		}
+		classes[c] = (unsigned char)j;
+	}
+	return classesSize;
 }
\ No newline at end of file
@@ -7,20 +7,39 @@ typedef struct DFAEntry DFAEntry;
 typedef struct DFAState DFAState;
 typedef struct DFA DFA;
 
+#define DFA_MODES_MAX (sizeof(size_t) * 8)
+#define DFA_TAGS_MAX (sizeof(size_t) * 8)
+/* Changes whenever DFA_FromEntries or DFA_Minimize build a different automaton for the same entries, or DFA_Save
+ * writes it differently, so that automata saved by an older generator are never loaded */
+#define DFA_VERSION 1
 struct DFAEntry
 {
 	NFAExpression expression;
 	const char *symbol;
+	size_t modes;
+	size_t tags;
 };
 struct DFAState
 {
 	const char *symbol;
 	DFAState *edges[DFASTATE_EDGES_MAX];
+	/* Tags whose register is set to the position after the byte that enters this state */
+	size_t tagsSet;
+	/* When a token ends here, tags of its rule that were not passed, that are at the token start,
+	 * or that cannot be told from a single register; the others are in their registers */
+	size_t tagsUnset;
+	size_t tagsStart;
+	size_t tagsAmbiguous;
 };
+VECTOR_DECLARE(DFAStateVector, DFAState *, 0)
 struct DFA
 {
 	StackAllocator allocator;
-	Vector states;
+	DFAStateVector states;
+	/* Peak bytes of the state keys DFA_FromEntries kept while building states */
+	size_t keysPeak;
+	/* Peak bytes of the allocator DFA_Minimize built the minimized states in, zero if it did not run */
+	size_t minimizedPeak;
 };
 
 void DFAState_Initialize(DFAState *state);
@@ -28,5 +47,16 @@ void DFAState_Initialize(DFAState *state);
 void DFA_Create(DFA *dfa);
 void DFA_Destroy(DFA *dfa);
 DFAState *DFA_AddState(DFA *dfa);
-DFAState *DFA_FromEntries(DFA *dfa, DFAEntry *entries, size_t expressionCount);
-DFAState *DFA_Minimize(DFA *dfa, DFAState *source);
\ No newline at end of file
+void DFA_FromEntries(DFA *dfa, DFAEntry *entries, size_t expressionCount, DFAState **starts, size_t modesSize);
+void DFA_Minimize(DFA *dfa, DFAState **starts, size_t startsSize);
+/* Orders states breadth-first from starts; with weights, indexed by the current order, heavier states come
+ * first and ties stay breadth-first */
+void DFA_Reorder(DFA *dfa, DFAState *const *starts, size_t startsSize, const size_t *weights);
+/* Scans input from start a token at a time, skipping rejected bytes, and adds the transitions taken out of
+ * each state to counts, indexed like dfa->states */
+void DFA_CountTransitions(const DFA *dfa, const DFAState *start, const char *input, size_t inputSize, size_t *counts);
+/* Writes the states and starts in a compact little-endian form, with symbols as indices into entries; DFA_Load
+ * reads them back into an empty DFA, and returns false if the input is malformed */
+void DFA_Save(const DFA *dfa, DFAState *const *starts, size_t startsSize, const DFAEntry *entries, size_t entriesSize, FILE *output);
+bool DFA_Load(DFA *dfa, DFAState **starts, size_t startsSize, const DFAEntry *entries, size_t entriesSize, FILE *input);
+size_t DFA_ComputeByteClasses(const DFA *dfa, unsigned char classes[DFASTATE_EDGES_MAX]);
\ No newline at end of file
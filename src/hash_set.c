@@ -1,14 +1,13 @@
 #include "hash_set.h"
 
-#include <string.h>
+#include <stdlib.h>
 
 void HashSet_Create(HashSet *hashSet, size_t initialCapacity, float loadFactor, size_t (*hash)(const void *), bool (*compare)(const void *, const void *))
 {
 	StackAllocator_Create(&hashSet->allocator, StackAllocator_DefaultGetNextCapacity);
 	hashSet->size = 0;
 	hashSet->capacity = initialCapacity;
-	hashSet->entries = StackAllocator_Allocate(&hashSet->allocator, initialCapacity * sizeof(HashSetEntry *));
-	memset(hashSet->entries, 0, initialCapacity * sizeof(HashSetEntry *));
+	hashSet->entries = calloc(initialCapacity, sizeof(HashSetEntry *));
 	hashSet->loadFactor = loadFactor;
 	hashSet->hash = hash;
 	hashSet->compare = compare;
@@ -16,29 +15,42 @@ void HashSet_Create(HashSet *hashSet, size_t initialCapacity, float loadFactor,
 void HashSet_Destroy(HashSet *hashSet)
 {
 	StackAllocator_Destroy(&hashSet->allocator);
+	free(hashSet->entries);
 }
-static void HashSet_Resize(HashSet *hashSet, size_t newCapacity)
+void HashSet_Clear(HashSet *hashSet)
 {
-	StackAllocator newAllocator;
-	StackAllocator_Create(&newAllocator, StackAllocator_DefaultGetNextCapacity);
+	/* Entries are packed in the allocator, so only their buckets are emptied, which costs the size of the set
+	 * rather than its capacity */
+	for (StackAllocation *allocation = hashSet->allocator.head; allocation; allocation = allocation->next)
+	{
+		const HashSetEntry *entries = StackAllocation_GetData(allocation);
+		for (size_t i = 0; i < allocation->size / sizeof(HashSetEntry); ++i)
+		{
+			hashSet->entries[hashSet->hash(entries[i].key) % hashSet->capacity] = NULL;
+		}
+	}
 	
-	HashSetEntry **newEntries = StackAllocator_Allocate(&newAllocator, newCapacity * sizeof(HashSetEntry *));
-	memset(newEntries, 0, newCapacity * sizeof(HashSetEntry *));
+	StackAllocatorMark empty = {hashSet->allocator.head, 0, 0};
+	StackAllocator_Rewind(&hashSet->allocator, empty);
+	hashSet->size = 0;
+}
+static void HashSet_Resize(HashSet *hashSet, size_t newCapacity)
+{
+	/* Entries keep their storage and are relinked in order, so a resize only replaces the buckets */
+	HashSetEntry **newEntries = calloc(newCapacity, sizeof(HashSetEntry *));
 	for (size_t i = 0; i < hashSet->capacity; ++i)
 	{
 		HashSetEntry *entry = hashSet->entries[i];
 		while (entry)
 		{
+			HashSetEntry *next = entry->next;
 			size_t newIndex = hashSet->hash(entry->key) % newCapacity;
-			
-			HashSetEntry *newEntry = StackAllocator_Allocate(&newAllocator, sizeof(HashSetEntry));
-			newEntry->key = entry->key;
-			newEntry->next = NULL;
+			entry->next = NULL;
 			
 			HashSetEntry *head = newEntries[newIndex];
 			if (!head)
 			{
-				newEntries[newIndex] = newEntry;
+				newEntries[newIndex] = entry;
 			}
 			else
 			{
@@ -46,15 +58,14 @@ static void HashSet_Resize(HashSet *hashSet, size_t newCapacity)
 				{
 					head = head->next;
 				}
-				head->next = newEntry;
+				head->next = entry;
 			}
 			
-			entry = entry->next;
+			entry = next;
 		}
 	}
 	
-	StackAllocator_Destroy(&hashSet->allocator);
-	hashSet->allocator = newAllocator;
+	free(hashSet->entries);
 	hashSet->capacity = newCapacity;
 	hashSet->entries = newEntries;
 }
@@ -23,6 +23,8 @@ struct HashSet
 
 void HashSet_Create(HashSet *hashSet, size_t initialCapacity, float loadFactor, size_t (*hash)(const void *), bool (*compare)(const void *, const void *));
 void HashSet_Destroy(HashSet *hashSet);
+/* Removes every key, keeping the buckets and the first block of entries for the next keys */
+void HashSet_Clear(HashSet *hashSet);
 void HashSet_Insert(HashSet *hashSet, const void *key);
 const void *HashSet_Find(const HashSet *hashSet, const void *key);
 void HashSet_ToArray(const HashSet *hashSet, const void **array);
\ No newline at end of file
@@ -1,14 +1,13 @@
 #include "hash_table.h"
 
-#include <string.h>
+#include <stdlib.h>
 
 void HashTable_Create(HashTable *hashTable, size_t initialCapacity, float loadFactor, size_t (*hash)(const void *), bool (*compare)(const void *, const void *))
 {
 	StackAllocator_Create(&hashTable->allocator, StackAllocator_DefaultGetNextCapacity);
 	hashTable->size = 0;
 	hashTable->capacity = initialCapacity;
-	hashTable->entries = StackAllocator_Allocate(&hashTable->allocator, initialCapacity * sizeof(HashTableEntry *));
-	memset(hashTable->entries, 0, initialCapacity * sizeof(HashTableEntry *));
+	hashTable->entries = calloc(initialCapacity, sizeof(HashTableEntry *));
 	hashTable->loadFactor = loadFactor;
 	hashTable->hash = hash;
 	hashTable->compare = compare;
@@ -16,30 +15,25 @@ void HashTable_Create(HashTable *hashTable, size_t initialCapacity, float loadFa
 void HashTable_Destroy(HashTable *hashTable)
 {
 	StackAllocator_Destroy(&hashTable->allocator);
+	free(hashTable->entries);
 }
 static void HashTable_Resize(HashTable *hashTable, size_t newCapacity)
 {
-	StackAllocator newAllocator;
-	StackAllocator_Create(&newAllocator, StackAllocator_DefaultGetNextCapacity);
-	
-	HashTableEntry **newEntries = StackAllocator_Allocate(&newAllocator, newCapacity * sizeof(HashTableEntry *));
-	memset(newEntries, 0, newCapacity * sizeof(HashTableEntry *));
+	/* Entries keep their storage and are relinked in order, so a resize only replaces the buckets */
+	HashTableEntry **newEntries = calloc(newCapacity, sizeof(HashTableEntry *));
 	for (size_t i = 0; i < hashTable->capacity; ++i)
 	{
 		HashTableEntry *entry = hashTable->entries[i];
 		while (entry)
 		{
+			HashTableEntry *next = entry->next;
 			size_t newIndex = hashTable->hash(entry->key) % newCapacity;
-			
-			HashTableEntry *newEntry = StackAllocator_Allocate(&newAllocator, sizeof(HashTableEntry));
-			newEntry->key = entry->key;
-			newEntry->value = entry->value;
-			newEntry->next = NULL;
+			entry->next = NULL;
 			
 			HashTableEntry *head = newEntries[newIndex];
 			if (!head)
 			{
-				newEntries[newIndex] = newEntry;
+				newEntries[newIndex] = entry;
 			}
 			else
 			{
@@ -47,15 +41,14 @@ static void HashTable_Resize(HashTable *hashTable, size_t newCapacity)
 				{
 					head = head->next;
 				}
-				head->next = newEntry;
+				head->next = entry;
 			}
 			
-			entry = entry->next;
+			entry = next;
 		}
 	}
 	
-	StackAllocator_Destroy(&hashTable->allocator);
-	hashTable->allocator = newAllocator;
+	free(hashTable->entries);
 	hashTable->capacity = newCapacity;
 	hashTable->entries = newEntries;
 }
@@ -1,5 +1,6 @@
 #include "nfa.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 void NFAEdgeConditions_Set(NFAEdgeConditions *conditions, size_t index)
@@ -36,6 +37,9 @@ void NFAEdgeConditions_Invert(NFAEdgeConditions *conditions)
 	{
 		conditions->bits[i] = ~conditions->bits[i];
 	}
+	
+	/* Condition 0 marks an epsilon edge, not a byte */
+	NFAEdgeConditions_Reset(conditions, 0);
 }
 
 void NFAState_Initialize(NFAState *state)
@@ -46,10 +50,16 @@ void NFAState_Initialize(NFAState *state)
 void NFA_Create(NFA *nfa)
 {
 	StackAllocator_Create(&nfa->allocator, StackAllocator_DefaultGetNextCapacity);
+	Vector_Create(&nfa->groups, 4);
 }
 void NFA_Destroy(NFA *nfa)
 {
 	StackAllocator_Destroy(&nfa->allocator);
+	for (size_t i = 0; i < nfa->groups.size; ++i)
+	{
+		free(Vector_Get(&nfa->groups, i));
+	}
+	Vector_Destroy(&nfa->groups);
 }
 NFAState *NFA_AddState(NFA *nfa)
 {
@@ -190,12 +200,64 @@ static void NFA_ParseRegexConditions(const char **regex, NFAEdgeConditions *cond
 		NFAEdgeConditions_Invert(conditions);
 	}
 }
+static void NFA_SetTag(NFAState *state, size_t tag)
+{
+	/* Tags past the limit are left out; the caller reports grammars with too many groups */
+	if (tag < sizeof(size_t) * 8)
+	{
+		state->tags |= (size_t)1 << tag;
+	}
+}
+/* Parses "?<name>inner)" into inner, between states that enter the group's begin and end tags */
+static void NFA_ParseRegexGroup(NFA *nfa, const char **regex, NFAExpression *expr)
+{
+	*regex += 2;
+	const char *nameStart = *regex;
+	while (**regex && **regex != '>')
+	{
+		++*regex;
+	}
+	assert(**regex == '>');
+	size_t nameSize = *regex - nameStart;
+	char *name = malloc(nameSize + 1);
+	memcpy(name, nameStart, nameSize);
+	name[nameSize] = 0;
+	++*regex;
+	
+	size_t group = nfa->groups.size;
+	Vector_Push(&nfa->groups, name);
+	
+	NFAExpression inner;
+	NFA_ParseRegexExpression(nfa, regex, &inner);
+	assert(**regex == ')');
+	++*regex;
+	
+	expr->start = NFA_AddState(nfa);
+	NFA_SetTag(expr->start, group * 2);
+	expr->start->left.state = inner.start;
+	NFAEdgeConditions_Set(&expr->start->left.conditions, 0);
+	
+	/* The end tag is entered before a plain end state, since ? and * skip to the end of what they repeat */
+	NFAState *endTag = NFA_AddState(nfa);
+	NFA_SetTag(endTag, group * 2 + 1);
+	inner.end->left.state = endTag;
+	NFAEdgeConditions_Set(&inner.end->left.conditions, 0);
+	
+	expr->end = NFA_AddState(nfa);
+	endTag->left.state = expr->end;
+	NFAEdgeConditions_Set(&endTag->left.conditions, 0);
+}
 void NFA_ParseRegexBase(NFA *nfa, const char **regex, NFAExpression *expr)
 {
 	switch (**regex)
 	{
 		case '(':
 			++*regex;
+			if (**regex == '?' && (*regex)[1] == '<')
+			{
+				NFA_ParseRegexGroup(nfa, regex, expr);
+				break;
+			}
 			NFA_ParseRegexExpression(nfa, regex, expr);
 			assert(**regex == ')');
 			++*regex;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "stack_allocator.h"
+#include "vector.h"
 
 typedef struct NFAEdgeConditions NFAEdgeConditions;
 typedef struct NFAEdge NFAEdge;
@@ -22,6 +23,8 @@ struct NFAState
 {
 	NFAEdge left;
 	NFAEdge right;
+	/* Tags entered with this state */
+	size_t tags;
 };
 struct NFAExpression
 {
@@ -31,6 +34,8 @@ struct NFAExpression
 struct NFA
 {
 	StackAllocator allocator;
+	/* Names of the (?<name>...) groups; group i enters tag 2 * i where it begins and 2 * i + 1 where it ends */
+	Vector groups;
 };
 
 void NFAEdgeConditions_Set(NFAEdgeConditions *condition, size_t index);
@@ -1,8 +1,104 @@
+#if defined(STACK_ALLOCATOR_HUGE_PAGES) && defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "stack_allocator.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* With STACK_ALLOCATOR_HUGE_PAGES on Linux, blocks of at least a huge page are mapped and advised to be backed
+ * by huge pages, and fall back to malloc if they cannot be mapped. Windows only grants large pages to accounts
+ * with SeLockMemoryPrivilege, so it keeps malloc */
+#if defined(STACK_ALLOCATOR_HUGE_PAGES) && defined(__linux__)
+#include <sys/mman.h>
+#define STACK_ALLOCATOR_HUGE_PAGE_SIZE ((size_t)2 << 20)
+#endif
+
+#if !defined(STACK_ALLOCATOR_FREE_BLOCKS_MAX)
+#define STACK_ALLOCATOR_FREE_BLOCKS_MAX 64
+#endif
+
+/* The free list is not synchronized; the generator is single-threaded */
+static StackAllocation *s_freeBlocks = NULL;
+static StackAllocatorStats s_stats;
+
+static StackAllocation *StackAllocator_NewBlock(size_t capacity)
+{
+#if defined(STACK_ALLOCATOR_HUGE_PAGE_SIZE)
+	size_t blockSize = sizeof(StackAllocation) + capacity;
+	if (blockSize >= STACK_ALLOCATOR_HUGE_PAGE_SIZE)
+	{
+		size_t mappedSize = (blockSize + STACK_ALLOCATOR_HUGE_PAGE_SIZE - 1) & ~(STACK_ALLOCATOR_HUGE_PAGE_SIZE - 1);
+		void *data = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (data != MAP_FAILED)
+		{
+			madvise(data, mappedSize, MADV_HUGEPAGE);
+			
+			StackAllocation *allocation = data;
+			allocation->capacity = mappedSize - sizeof(StackAllocation);
+			allocation->mapped = true;
+			return allocation;
+		}
+	}
+#endif
+	StackAllocation *allocation = malloc(sizeof(StackAllocation) + capacity);
+	allocation->capacity = capacity;
+	allocation->mapped = false;
+	return allocation;
+}
+static void StackAllocator_DeleteBlock(StackAllocation *allocation)
+{
+#if defined(STACK_ALLOCATOR_HUGE_PAGE_SIZE)
+	if (allocation->mapped)
+	{
+		munmap(allocation, sizeof(StackAllocation) + allocation->capacity);
+		return;
+	}
+#endif
+	free(allocation);
+}
+/* Takes the smallest free block with at least capacity bytes, or a new one */
+static StackAllocation *StackAllocator_TakeBlock(size_t capacity)
+{
+	StackAllocation **best = NULL;
+	for (StackAllocation **block = &s_freeBlocks; *block; block = &(*block)->next)
+	{
+		if ((*block)->capacity >= capacity && (!best || (*block)->capacity < (*best)->capacity))
+		{
+			best = block;
+		}
+	}
+	
+	if (!best)
+	{
+		++s_stats.blocksAllocated;
+		return StackAllocator_NewBlock(capacity);
+	}
+	
+	StackAllocation *allocation = *best;
+	*best = allocation->next;
+	++s_stats.blocksReused;
+	--s_stats.freeBlocks;
+	s_stats.freeBytes -= sizeof(StackAllocation) + allocation->capacity;
+	return allocation;
+}
+static void StackAllocator_ReleaseBlock(StackAllocator *allocator, StackAllocation *allocation)
+{
+	allocator->reserved -= sizeof(StackAllocation) + allocation->capacity;
+	if (s_stats.freeBlocks == STACK_ALLOCATOR_FREE_BLOCKS_MAX)
+	{
+		StackAllocator_DeleteBlock(allocation);
+		return;
+	}
+	
+	allocation->next = s_freeBlocks;
+	s_freeBlocks = allocation;
+	++s_stats.freeBlocks;
+	s_stats.freeBytes += sizeof(StackAllocation) + allocation->capacity;
+}
+
 void *StackAllocation_GetData(const StackAllocation *allocation)
 {
 	return (char *)allocation + sizeof(StackAllocation);
@@ -13,6 +109,9 @@ void StackAllocator_Create(StackAllocator *allocator, StackAllocatorGetNextCapac
 	allocator->head = NULL;
 	allocator->tail = NULL;
 	allocator->size = 0;
+	allocator->peak = 0;
+	allocator->reserved = 0;
+	allocator->reservedPeak = 0;
 	allocator->getNextCapacity = getNextCapacity;
 }
 void StackAllocator_Destroy(StackAllocator *allocator)
@@ -20,31 +119,44 @@ void StackAllocator_Destroy(StackAllocator *allocator)
 	StackAllocation *head = allocator->head;
 	while (head)
 	{
-		void *data = head;
-		head = head->next;
-		free(data);
+		StackAllocation *next = head->next;
+		StackAllocator_ReleaseBlock(allocator, head);
+		head = next;
 	}
 }
 void *StackAllocator_Allocate(StackAllocator *allocator, size_t requestSize)
 {
-	allocator->size += requestSize;
+	return StackAllocator_AllocateAligned(allocator, requestSize, 1);
+}
+void *StackAllocator_AllocateAligned(StackAllocator *allocator, size_t requestSize, size_t alignment)
+{
+	assert(alignment && !(alignment & (alignment - 1)));
 	
 	/* Check if last allocation has room */
-	if (allocator->tail &&
-		allocator->tail->capacity - allocator->tail->size >= requestSize)
+	if (allocator->tail)
 	{
-		void *result = (char *)StackAllocation_GetData(allocator->tail) + allocator->tail->size;
-		allocator->tail->size += requestSize;
-		return result;
+		char *end = (char *)StackAllocation_GetData(allocator->tail) + allocator->tail->size;
+		size_t padding = (size_t)(-(uintptr_t)end & (alignment - 1));
+		if (allocator->tail->capacity - allocator->tail->size >= padding + requestSize)
+		{
+			allocator->tail->size += padding + requestSize;
+			allocator->size += padding + requestSize;
+			if (allocator->size > allocator->peak)
+			{
+				allocator->peak = allocator->size;
+			}
+			return end + padding;
+		}
 	}
 	
-	/* Make a new allocation */
-	size_t nextCapacity = allocator->getNextCapacity(allocator, sizeof(StackAllocation) + requestSize);
-	assert(nextCapacity >= sizeof(StackAllocation) + requestSize);
+	/* Make a new allocation, with room to align its data */
+	size_t nextCapacity = allocator->getNextCapacity(allocator, sizeof(StackAllocation) + requestSize + alignment - 1);
+	assert(nextCapacity >= sizeof(StackAllocation) + requestSize + alignment - 1);
 	
-	StackAllocation *allocation = malloc(sizeof(StackAllocation) + nextCapacity);
-	allocation->size = requestSize;
-	allocation->capacity = nextCapacity - sizeof(StackAllocator);
+	StackAllocation *allocation = StackAllocator_TakeBlock(nextCapacity - sizeof(StackAllocation));
+	char *data = StackAllocation_GetData(allocation);
+	size_t padding = (size_t)(-(uintptr_t)data & (alignment - 1));
+	allocation->size = padding + requestSize;
 	allocation->next = NULL;
 	
 	if (!allocator->tail)
@@ -60,7 +172,18 @@ void *StackAllocator_Allocate(StackAllocator *allocator, size_t requestSize)
 		allocator->tail = allocation;
 	}
 	
-	return StackAllocation_GetData(allocation);
+	allocator->size += padding + requestSize;
+	if (allocator->size > allocator->peak)
+	{
+		allocator->peak = allocator->size;
+	}
+	allocator->reserved += sizeof(StackAllocation) + allocation->capacity;
+	if (allocator->reserved > allocator->reservedPeak)
+	{
+		allocator->reservedPeak = allocator->reserved;
+	}
+	
+	return data + padding;
 }
 void StackAllocator_Free(StackAllocator *allocator, size_t requestSize)
 {
@@ -70,9 +193,10 @@ void StackAllocator_Free(StackAllocator *allocator, size_t requestSize)
 	if (allocator->tail->size == 0)
 	{
 		StackAllocation *prev = allocator->tail->prev;
-		free(allocator->tail);
+		StackAllocator_ReleaseBlock(allocator, allocator->tail);
 		if (prev)
 		{
+			prev->next = NULL;
 			allocator->tail = prev;
 		}
 		else
@@ -82,6 +206,31 @@ void StackAllocator_Free(StackAllocator *allocator, size_t requestSize)
 		}
 	}
 }
+StackAllocatorMark StackAllocator_Mark(const StackAllocator *allocator)
+{
+	StackAllocatorMark mark = {allocator->tail, (allocator->tail ? allocator->tail->size : 0), allocator->size};
+	return mark;
+}
+void StackAllocator_Rewind(StackAllocator *allocator, StackAllocatorMark mark)
+{
+	while (allocator->tail != mark.tail)
+	{
+		StackAllocation *prev = allocator->tail->prev;
+		StackAllocator_ReleaseBlock(allocator, allocator->tail);
+		allocator->tail = prev;
+	}
+	
+	if (mark.tail)
+	{
+		mark.tail->size = mark.tailSize;
+		mark.tail->next = NULL;
+	}
+	else
+	{
+		allocator->head = NULL;
+	}
+	allocator->size = mark.size;
+}
 size_t StackAllocator_DefaultGetNextCapacity(const StackAllocator *allocator, size_t requestSize)
 {
 	/* 1KB */
@@ -110,4 +259,20 @@ size_t StackAllocator_Write(StackAllocator *allocator, FILE *output)
 		fwrite(StackAllocation_GetData(allocation), 1, allocation->size, output);
 	}
 	return result;
+}
+
+void StackAllocator_GetStats(StackAllocatorStats *stats)
+{
+	*stats = s_stats;
+}
+void StackAllocator_ReleaseFreeBlocks(void)
+{
+	while (s_freeBlocks)
+	{
+		StackAllocation *next = s_freeBlocks->next;
+		StackAllocator_DeleteBlock(s_freeBlocks);
+		s_freeBlocks = next;
+	}
+	s_stats.freeBlocks = 0;
+	s_stats.freeBytes = 0;
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 
 typedef struct StackAllocation StackAllocation;
 typedef struct StackAllocator StackAllocator;
+typedef struct StackAllocatorMark StackAllocatorMark;
+typedef struct StackAllocatorStats StackAllocatorStats;
 typedef size_t (*StackAllocatorGetNextCapacityFunc)(const StackAllocator *, size_t);
 
 struct StackAllocation
@@ -14,6 +16,8 @@ struct StackAllocation
 	size_t capacity;
 	StackAllocation *prev;
 	StackAllocation *next;
+	/* Mapped for huge pages rather than taken from malloc */
+	bool mapped;
 };
 
 void *StackAllocation_GetData(const StackAllocation *allocation);
@@ -23,12 +27,43 @@ struct StackAllocator
 	StackAllocation *head;
 	StackAllocation *tail;
 	size_t size;
+	/* Largest size reached so far */
+	size_t peak;
+	/* Bytes of the blocks held, headers included, and the most held at once */
+	size_t reserved;
+	size_t reservedPeak;
 	StackAllocatorGetNextCapacityFunc getNextCapacity;
 };
 
+/* A point to rewind to; rewinding releases everything allocated after it at once */
+struct StackAllocatorMark
+{
+	StackAllocation *tail;
+	size_t tailSize;
+	size_t size;
+};
+
+/* Block traffic of every allocator in the process. Emptied blocks go to a free list that all allocators
+ * share, so that short-lived allocators and resized containers reuse blocks instead of going back to malloc */
+struct StackAllocatorStats
+{
+	size_t blocksAllocated;
+	size_t blocksReused;
+	size_t freeBlocks;
+	size_t freeBytes;
+};
+
 void StackAllocator_Create(StackAllocator *allocator, StackAllocatorGetNextCapacityFunc getNextCapacity);
 void StackAllocator_Destroy(StackAllocator *allocator);
 void *StackAllocator_Allocate(StackAllocator *allocator, size_t requestSize);
+/* alignment is a power of two; the padding before the result is only released by StackAllocator_Rewind */
+void *StackAllocator_AllocateAligned(StackAllocator *allocator, size_t requestSize, size_t alignment);
 void StackAllocator_Free(StackAllocator *allocator, size_t requestSize);
+StackAllocatorMark StackAllocator_Mark(const StackAllocator *allocator);
+void StackAllocator_Rewind(StackAllocator *allocator, StackAllocatorMark mark);
 size_t StackAllocator_DefaultGetNextCapacity(const StackAllocator *allocator, size_t requestSize);
-size_t StackAllocator_Write(StackAllocator *allocator, FILE *output);
\ No newline at end of file
+size_t StackAllocator_Write(StackAllocator *allocator, FILE *output);
+
+void StackAllocator_GetStats(StackAllocatorStats *stats);
+/* Returns the blocks on the free list to the system */
+void StackAllocator_ReleaseFreeBlocks(void);
\ No newline at end of file
@@ -2,4 +2,15 @@
 
 #include <assert.h>
 #include <stdbool.h>
-#include <stddef.h>
\ No newline at end of file
+#include <stddef.h>
+
+#if !defined(_MSC_VER)
+#include <stdio.h>
+
+/* The generator opens files with the MSVC CRT's fopen_s; other compilers get this stand-in */
+static inline int fopen_s(FILE **file, const char *path, const char *mode)
+{
+	*file = fopen(path, mode);
+	return (*file ? 0 : -1);
+}
+#endif
\ No newline at end of file
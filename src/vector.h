@@ -1,6 +1,117 @@
 #pragma once
 
-#include "util.h"
+#include "stack_allocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define VECTOR_MIN_CAPACITY 16
+
+/* Declares Name, a vector of Type that keeps its first inlineCapacity elements in the vector itself, which may
+ * be 0. Past those it grows in the allocator given to Name_Create, which keeps the storage it outgrows, or with
+ * malloc if there is none. Inline storage moves with the vector, so vectors are exchanged with Name_Swap */
+#define VECTOR_DECLARE(Name, Type, inlineCapacity) \
+typedef struct Name Name; \
+typedef struct Name##Alignment Name##Alignment; \
+struct Name \
+{ \
+	Type *data; \
+	size_t size; \
+	size_t capacity; \
+	StackAllocator *allocator; \
+	Type inlineData[(inlineCapacity) ? (inlineCapacity) : 1]; \
+}; \
+struct Name##Alignment \
+{ \
+	char c; \
+	Type value; \
+}; \
+static inline void Name##_Create(Name *vector, StackAllocator *allocator) \
+{ \
+	vector->data = vector->inlineData; \
+	vector->size = 0; \
+	vector->capacity = (inlineCapacity); \
+	vector->allocator = allocator; \
+} \
+static inline void Name##_Destroy(Name *vector) \
+{ \
+	if (!vector->allocator && vector->data != vector->inlineData) \
+	{ \
+		free(vector->data); \
+	} \
+} \
+static inline Type Name##_Get(const Name *vector, size_t index) \
+{ \
+	return vector->data[index]; \
+} \
+static inline void Name##_Set(Name *vector, size_t index, Type value) \
+{ \
+	vector->data[index] = value; \
+} \
+static inline void Name##_Reserve(Name *vector, size_t capacity) \
+{ \
+	if (capacity <= vector->capacity) \
+	{ \
+		return; \
+	} \
+	\
+	size_t newCapacity = vector->capacity + vector->capacity / 2; \
+	if (newCapacity < VECTOR_MIN_CAPACITY) \
+	{ \
+		newCapacity = VECTOR_MIN_CAPACITY; \
+	} \
+	if (newCapacity < capacity) \
+	{ \
+		newCapacity = capacity; \
+	} \
+	\
+	Type *newData; \
+	if (vector->allocator) \
+	{ \
+		newData = StackAllocator_AllocateAligned(vector->allocator, newCapacity * sizeof(Type), offsetof(Name##Alignment, value)); \
+	} \
+	else \
+	{ \
+		newData = malloc(newCapacity * sizeof(Type)); \
+	} \
+	memcpy(newData, vector->data, vector->size * sizeof(Type)); \
+	Name##_Destroy(vector); \
+	vector->data = newData; \
+	vector->capacity = newCapacity; \
+} \
+static inline void Name##_Push(Name *vector, Type value) \
+{ \
+	if (vector->size == vector->capacity) \
+	{ \
+		Name##_Reserve(vector, vector->size + 1); \
+	} \
+	\
+	vector->data[vector->size] = value; \
+	++vector->size; \
+} \
+static inline Type Name##_Pop(Name *vector) \
+{ \
+	--vector->size; \
+	return vector->data[vector->size]; \
+} \
+static inline void Name##_Clear(Name *vector) \
+{ \
+	vector->size = 0; \
+} \
+static inline void Name##_Swap(Name *a, Name *b) \
+{ \
+	Name temp = *a; \
+	*a = *b; \
+	*b = temp; \
+	if (a->data == b->inlineData) \
+	{ \
+		a->data = a->inlineData; \
+	} \
+	if (b->data == a->inlineData) \
+	{ \
+		b->data = b->inlineData; \
+	} \
+}
 
 typedef struct Vector Vector;
 
@@ -11,7 +11,10 @@ void ParseSource(const char *c)
 		type = CLex(&c);
 		if (type == TokenType_CLex_Reject)
 		{
-			break;
+			/* Report the rejected token and everything up to the next possible token start as one error */
+			CLex_Recover(&c);
+			printf("Error:\n\t'%.*s'\n", (int)(c - begin), begin);
+			continue;
 		}
 		
 		const char *typeName = NULL;
@@ -60,6 +63,7 @@ int main()
 	ParseSource("// This is a good comment :)\n\
 /* this is an evil \n mean comment from hell **/ /* this is a separate one */ int main()\n\
 {\n\
+	int $$x = 2 @@ 2;\n\
 	return 4;\n\
 }");
 }
\ No newline at end of file
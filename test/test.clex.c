@@ -2,6 +2,20 @@
 
 #include "test.clex.h"
 
+#include <string.h>
+
+#include <stdint.h>
+
+#if !defined(CLEX_SSSE3) && (defined(__SSSE3__) || defined(__AVX__))
+#define CLEX_SSSE3
+#endif
+#if defined(CLEX_SSSE3)
+#include <tmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
 typedef struct State State;
 struct State
 {
@@ -12,35 +26,68 @@ struct State
 static const State k_states[] =
 {
 	{TokenType_CLex_Reject, {[0] = 0}},
-	{TokenType_CLex_Reject, {[0] = 0, [9] = 19, [10] = 19, [13] = 19, [32] = 19, [40] = 17, [41] = 20, [47] = 2, [48] = 23, [49] = 23, [50] = 23, [51] = 23, [52] = 23, [53] = 23, [54] = 23, [55] = 23, [56] = 23, [57] = 23, [59] = 7, [65] = 10, [66] = 10, [67] = 10, [68] = 10, [69] = 10, [70] = 10, [71] = 10, [72] = 10, [73] = 10, [74] = 10, [75] = 10, [76] = 10, [77] = 10, [78] = 10, [79] = 10, [80] = 10, [81] = 10, [82] = 10, [83] = 10, [84] = 10, [85] = 10, [86] = 10, [87] = 10, [88] = 10, [89] = 10, [90] = 10, [97] = 10, [98] = 10, [99] = 10, [100] = 10, [101] = 10, [102] = 10, [103] = 10, [104] = 10, [105] = 14, [106] = 10, [107] = 10, [108] = 10, [109] = 10, [110] = 10, [111] = 10, [112] = 10, [113] = 10, [114] = 11, [115] = 10, [116] = 10, [117] = 10, [118] = 10, [119] = 10, [120] = 10, [121] = 10, [122] = 10, [123] = 22, [125] = 18}},
-	{TokenType_CLex_Reject, {[0] = 0, [42] = 5, [47] = 6}},
-	{TokenType_CLex_Reject, {[0] = 0, [10] = 24}},
-	{TokenType_CLex_Reject, {[0] = 0, [1] = 5, [2] = 5, [3] = 5, [4] = 5, [5] = 5, [6] = 5, [7] = 5, [8] = 5, [9] = 5, [10] = 5, [11] = 5, [12] = 5, [13] = 5, [14] = 5, [15] = 5, [16] = 5, [17] = 5, [18] = 5, [19] = 5, [20] = 5, [21] = 5, [22] = 5, [23] = 5, [24] = 5, [25] = 5, [26] = 5, [27] = 5, [28] = 5, [29] = 5, [30] = 5, [31] = 5, [32] = 5, [33] = 5, [34] = 5, [35] = 5, [36] = 5, [37] = 5, [38] = 5, [39] = 5, [40] = 5, [41] = 5, [42] = 4, [43] = 5, [44] = 5, [45] = 5, [46] = 5, [47] = 24, [48] = 5, [49] = 5, [50] = 5, [51] = 5, [52] = 5, [53] = 5, [54] = 5, [55] = 5, [56] = 5, [57] = 5, [58] = 5, [59] = 5, [60] = 5, [61] = 5, [62] = 5, [63] = 5, [64] = 5, [65] = 5, [66] = 5, [67] = 5, [68] = 5, [69] = 5, [70] = 5, [71] = 5, [72] = 5, [73] = 5, [74] = 5, [75] = 5, [76] = 5, [77] = 5, [78] = 5, [79] = 5, [80] = 5, [81] = 5, [82] = 5, [83] = 5, [84] = 5, [85] = 5, [86] = 5, [87] = 5, [88] = 5, [89] = 5, [90] = 5, [91] = 5, [92] = 5, [93] = 5, [94] = 5, [95] = 5, [96] = 5, [97] = 5, [98] = 5, [99] = 5, [100] = 5, [101] = 5, [102] = 5, [103] = 5, [104] = 5, [105] = 5, [106] = 5, [107] = 5, [108] = 5, [109] = 5, [110] = 5, [111] = 5, [112] = 5, [113] = 5, [114] = 5, [115] = 5, [116] = 5, [117] = 5, [118] = 5, [119] = 5, [120] = 5, [121] = 5, [122] = 5, [123] = 5, [124] = 5, [125] = 5, [126] = 5, [127] = 5}},
-	{TokenType_CLex_Reject, {[0] = 0, [1] = 5, [2] = 5, [3] = 5, [4] = 5, [5] = 5, [6] = 5, [7] = 5, [8] = 5, [9] = 5, [10] = 5, [11] = 5, [12] = 5, [13] = 5, [14] = 5, [15] = 5, [16] = 5, [17] = 5, [18] = 5, [19] = 5, [20] = 5, [21] = 5, [22] = 5, [23] = 5, [24] = 5, [25] = 5, [26] = 5, [27] = 5, [28] = 5, [29] = 5, [30] = 5, [31] = 5, [32] = 5, [33] = 5, [34] = 5, [35] = 5, [36] = 5, [37] = 5, [38] = 5, [39] = 5, [40] = 5, [41] = 5, [42] = 4, [43] = 5, [44] = 5, [45] = 5, [46] = 5, [48] = 5, [49] = 5, [50] = 5, [51] = 5, [52] = 5, [53] = 5, [54] = 5, [55] = 5, [56] = 5, [57] = 5, [58] = 5, [59] = 5, [60] = 5, [61] = 5, [62] = 5, [63] = 5, [64] = 5, [65] = 5, [66] = 5, [67] = 5, [68] = 5, [69] = 5, [70] = 5, [71] = 5, [72] = 5, [73] = 5, [74] = 5, [75] = 5, [76] = 5, [77] = 5, [78] = 5, [79] = 5, [80] = 5, [81] = 5, [82] = 5, [83] = 5, [84] = 5, [85] = 5, [86] = 5, [87] = 5, [88] = 5, [89] = 5, [90] = 5, [91] = 5, [92] = 5, [93] = 5, [94] = 5, [95] = 5, [96] = 5, [97] = 5, [98] = 5, [99] = 5, [100] = 5, [101] = 5, [102] = 5, [103] = 5, [104] = 5, [105] = 5, [106] = 5, [107] = 5, [108] = 5, [109] = 5, [110] = 5, [111] = 5, [112] = 5, [113] = 5, [114] = 5, [115] = 5, [116] = 5, [117] = 5, [118] = 5, [119] = 5, [120] = 5, [121] = 5, [122] = 5, [123] = 5, [124] = 5, [125] = 5, [126] = 5, [127] = 5}},
-	{TokenType_CLex_Reject, {[0] = 0, [1] = 6, [2] = 6, [3] = 6, [4] = 6, [5] = 6, [6] = 6, [7] = 6, [8] = 6, [9] = 6, [10] = 24, [11] = 6, [12] = 6, [13] = 3, [14] = 6, [15] = 6, [16] = 6, [17] = 6, [18] = 6, [19] = 6, [20] = 6, [21] = 6, [22] = 6, [23] = 6, [24] = 6, [25] = 6, [26] = 6, [27] = 6, [28] = 6, [29] = 6, [30] = 6, [31] = 6, [32] = 6, [33] = 6, [34] = 6, [35] = 6, [36] = 6, [37] = 6, [38] = 6, [39] = 6, [40] = 6, [41] = 6, [42] = 6, [43] = 6, [44] = 6, [45] = 6, [46] = 6, [47] = 6, [48] = 6, [49] = 6, [50] = 6, [51] = 6, [52] = 6, [53] = 6, [54] = 6, [55] = 6, [56] = 6, [57] = 6, [58] = 6, [59] = 6, [60] = 6, [61] = 6, [62] = 6, [63] = 6, [64] = 6, [65] = 6, [66] = 6, [67] = 6, [68] = 6, [69] = 6, [70] = 6, [71] = 6, [72] = 6, [73] = 6, [74] = 6, [75] = 6, [76] = 6, [77] = 6, [78] = 6, [79] = 6, [80] = 6, [81] = 6, [82] = 6, [83] = 6, [84] = 6, [85] = 6, [86] = 6, [87] = 6, [88] = 6, [89] = 6, [90] = 6, [91] = 6, [92] = 6, [93] = 6, [94] = 6, [95] = 6, [96] = 6, [97] = 6, [98] = 6, [99] = 6, [100] = 6, [101] = 6, [102] = 6, [103] = 6, [104] = 6, [105] = 6, [106] = 6, [107] = 6, [108] = 6, [109] = 6, [110] = 6, [111] = 6, [112] = 6, [113] = 6, [114] = 6, [115] = 6, [116] = 6, [117] = 6, [118] = 6, [119] = 6, [120] = 6, [121] = 6, [122] = 6, [123] = 6, [124] = 6, [125] = 6, [126] = 6, [127] = 6}},
-	{TokenType_Semicolon, {[0] = 0}},
-	{TokenType_KeywordInt, {[0] = 0, [48] = 10, [49] = 10, [50] = 10, [51] = 10, [52] = 10, [53] = 10, [54] = 10, [55] = 10, [56] = 10, [57] = 10, [65] = 10, [66] = 10, [67] = 10, [68] = 10, [69] = 10, [70] = 10, [71] = 10, [72] = 10, [73] = 10, [74] = 10, [75] = 10, [76] = 10, [77] = 10, [78] = 10, [79] = 10, [80] = 10, [81] = 10, [82] = 10, [83] = 10, [84] = 10, [85] = 10, [86] = 10, [87] = 10, [88] = 10, [89] = 10, [90] = 10, [97] = 10, [98] = 10, [99] = 10, [100] = 10, [101] = 10, [102] = 10, [103] = 10, [104] = 10, [105] = 10, [106] = 10, [107] = 10, [108] = 10, [109] = 10, [110] = 10, [111] = 10, [112] = 10, [113] = 10, [114] = 10, [115] = 10, [116] = 10, [117] = 10, [118] = 10, [119] = 10, [120] = 10, [121] = 10, [122] = 10}},
-	{TokenType_Identifier, {[0] = 0, [48] = 10, [49] = 10, [50] = 10, [51] = 10, [52] = 10, [53] = 10, [54] = 10, [55] = 10, [56] = 10, [57] = 10, [65] = 10, [66] = 10, [67] = 10, [68] = 10, [69] = 10, [70] = 10, [71] = 10, [72] = 10, [73] = 10, [74] = 10, [75] = 10, [76] = 10, [77] = 10, [78] = 10, [79] = 10, [80] = 10, [81] = 10, [82] = 10, [83] = 10, [84] = 10, [85] = 10, [86] = 10, [87] = 10, [88] = 10, [89] = 10, [90] = 10, [97] = 10, [98] = 10, [99] = 10, [100] = 10, [101] = 10, [102] = 10, [103] = 10, [104] = 10, [105] = 10, [106] = 10, [107] = 10, [108] = 10, [109] = 10, [110] = 10, [111] = 10, [112] = 10, [113] = 10, [114] = 10, [115] = 10, [116] = 12, [117] = 10, [118] = 10, [119] = 10, [120] = 10, [121] = 10, [122] = 10}},
-	{TokenType_Identifier, {[0] = 0, [48] = 10, [49] = 10, [50] = 10, [51] = 10, [52] = 10, [53] = 10, [54] = 10, [55] = 10, [56] = 10, [57] = 10, [65] = 10, [66] = 10, [67] = 10, [68] = 10, [69] = 10, [70] = 10, [71] = 10, [72] = 10, [73] = 10, [74] = 10, [75] = 10, [76] = 10, [77] = 10, [78] = 10, [79] = 10, [80] = 10, [81] = 10, [82] = 10, [83] = 10, [84] = 10, [85] = 10, [86] = 10, [87] = 10, [88] = 10, [89] = 10, [90] = 10, [97] = 10, [98] = 10, [99] = 10, [100] = 10, [101] = 10, [102] = 10, [103] = 10, [104] = 10, [105] = 10, [106] = 10, [107] = 10, [108] = 10, [109] = 10, [110] = 10, [111] = 10, [112] = 10, [113] = 10, [114] = 10, [115] = 10, [116] = 10, [117] = 10, [118] = 10, [119] = 10, [120] = 10, [121] = 10, [122] = 10}},
-	{TokenType_Identifier, {[0] = 0, [48] = 10, [49] = 10, [50] = 10, [51] = 10, [52] = 10, [53] = 10, [54] = 10, [55] = 10, [56] = 10, [57] = 10, [65] = 10, [66] = 10, [67] = 10, [68] = 10, [69] = 10, [70] = 10, [71] = 10, [72] = 10, [73] = 10, [74] = 10, [75] = 10, [76] = 10, [77] = 10, [78] = 10, [79] = 10, [80] = 10, [81] = 10, [82] = 10, [83] = 10, [84] = 10, [85] = 10, [86] = 10, [87] = 10, [88] = 10, [89] = 10, [90] = 10, [97] = 10, [98] = 10, [99] = 10, [100] = 10, [101] = 9, [102] = 10, [103] = 10, [104] = 10, [105] = 10, [106] = 10, [107] = 10, [108] = 10, [109] = 10, [110] = 10, [111] = 10, [112] = 10, [113] = 10, [114] = 10, [115] = 10, [116] = 10, [117] = 10, [118] = 10, [119] = 10, [120] = 10, [121] = 10, [122] = 10}},
-	{TokenType_Identifier, {[0] = 0, [48] = 10, [49] = 10, [50] = 10, [51] = 10, [52] = 10, [53] = 10, [54] = 10, [55] = 10, [56] = 10, [57] = 10, [65] = 10, [66] = 10, [67] = 10, [68] = 10, [69] = 10, [70] = 10, [71] = 10, [72] = 10, [73] = 10, [74] = 10, [75] = 10, [76] = 10, [77] = 10, [78] = 10, [79] = 10, [80] = 10, [81] = 10, [82] = 10, [83] = 10, [84] = 10, [85] = 10, [86] = 10, [87] = 10, [88] = 10, [89] = 10, [90] = 10, [97] = 10, [98] = 10, [99] = 10, [100] = 10, [101] = 10, [102] = 10, [103] = 10, [104] = 10, [105] = 10, [106] = 10, [107] = 10, [108] = 10, [109] = 10, [110] = 10, [111] = 10, [112] = 10, [113] = 10, [114] = 10, [115] = 10, [116] = 10, [117] = 13, [118] = 10, [119] = 10, [120] = 10, [121] = 10, [122] = 10}},
-	{TokenType_Identifier, {[0] = 0, [48] = 10, [49] = 10, [50] = 10, [51] = 10, [52] = 10, [53] = 10, [54] = 10, [55] = 10, [56] = 10, [57] = 10, [65] = 10, [66] = 10, [67] = 10, [68] = 10, [69] = 10, [70] = 10, [71] = 10, [72] = 10, [73] = 10, [74] = 10, [75] = 10, [76] = 10, [77] = 10, [78] = 10, [79] = 10, [80] = 10, [81] = 10, [82] = 10, [83] = 10, [84] = 10, [85] = 10, [86] = 10, [87] = 10, [88] = 10, [89] = 10, [90] = 10, [97] = 10, [98] = 10, [99] = 10, [100] = 10, [101] = 10, [102] = 10, [103] = 10, [104] = 10, [105] = 10, [106] = 10, [107] = 10, [108] = 10, [109] = 10, [110] = 10, [111] = 10, [112] = 10, [113] = 10, [114] = 16, [115] = 10, [116] = 10, [117] = 10, [118] = 10, [119] = 10, [120] = 10, [121] = 10, [122] = 10}},
-	{TokenType_Identifier, {[0] = 0, [48] = 10, [49] = 10, [50] = 10, [51] = 10, [52] = 10, [53] = 10, [54] = 10, [55] = 10, [56] = 10, [57] = 10, [65] = 10, [66] = 10, [67] = 10, [68] = 10, [69] = 10, [70] = 10, [71] = 10, [72] = 10, [73] = 10, [74] = 10, [75] = 10, [76] = 10, [77] = 10, [78] = 10, [79] = 10, [80] = 10, [81] = 10, [82] = 10, [83] = 10, [84] = 10, [85] = 10, [86] = 10, [87] = 10, [88] = 10, [89] = 10, [90] = 10, [97] = 10, [98] = 10, [99] = 10, [100] = 10, [101] = 10, [102] = 10, [103] = 10, [104] = 10, [105] = 10, [106] = 10, [107] = 10, [108] = 10, [109] = 10, [110] = 15, [111] = 10, [112] = 10, [113] = 10, [114] = 10, [115] = 10, [116] = 10, [117] = 10, [118] = 10, [119] = 10, [120] = 10, [121] = 10, [122] = 10}},
-	{TokenType_Identifier, {[0] = 0, [48] = 10, [49] = 10, [50] = 10, [51] = 10, [52] = 10, [53] = 10, [54] = 10, [55] = 10, [56] = 10, [57] = 10, [65] = 10, [66] = 10, [67] = 10, [68] = 10, [69] = 10, [70] = 10, [71] = 10, [72] = 10, [73] = 10, [74] = 10, [75] = 10, [76] = 10, [77] = 10, [78] = 10, [79] = 10, [80] = 10, [81] = 10, [82] = 10, [83] = 10, [84] = 10, [85] = 10, [86] = 10, [87] = 10, [88] = 10, [89] = 10, [90] = 10, [97] = 10, [98] = 10, [99] = 10, [100] = 10, [101] = 10, [102] = 10, [103] = 10, [104] = 10, [105] = 10, [106] = 10, [107] = 10, [108] = 10, [109] = 10, [110] = 10, [111] = 10, [112] = 10, [113] = 10, [114] = 10, [115] = 10, [116] = 8, [117] = 10, [118] = 10, [119] = 10, [120] = 10, [121] = 10, [122] = 10}},
-	{TokenType_Identifier, {[0] = 0, [48] = 10, [49] = 10, [50] = 10, [51] = 10, [52] = 10, [53] = 10, [54] = 10, [55] = 10, [56] = 10, [57] = 10, [65] = 10, [66] = 10, [67] = 10, [68] = 10, [69] = 10, [70] = 10, [71] = 10, [72] = 10, [73] = 10, [74] = 10, [75] = 10, [76] = 10, [77] = 10, [78] = 10, [79] = 10, [80] = 10, [81] = 10, [82] = 10, [83] = 10, [84] = 10, [85] = 10, [86] = 10, [87] = 10, [88] = 10, [89] = 10, [90] = 10, [97] = 10, [98] = 10, [99] = 10, [100] = 10, [101] = 10, [102] = 10, [103] = 10, [104] = 10, [105] = 10, [106] = 10, [107] = 10, [108] = 10, [109] = 10, [110] = 21, [111] = 10, [112] = 10, [113] = 10, [114] = 10, [115] = 10, [116] = 10, [117] = 10, [118] = 10, [119] = 10, [120] = 10, [121] = 10, [122] = 10}},
+	{TokenType_CLex_Reject, {[0] = 0, [9] = 2, [10] = 2, [13] = 2, [32] = 2, [40] = 3, [41] = 4, [47] = 5, [48] = 6, [49] = 6, [50] = 6, [51] = 6, [52] = 6, [53] = 6, [54] = 6, [55] = 6, [56] = 6, [57] = 6, [59] = 7, [65] = 8, [66] = 8, [67] = 8, [68] = 8, [69] = 8, [70] = 8, [71] = 8, [72] = 8, [73] = 8, [74] = 8, [75] = 8, [76] = 8, [77] = 8, [78] = 8, [79] = 8, [80] = 8, [81] = 8, [82] = 8, [83] = 8, [84] = 8, [85] = 8, [86] = 8, [87] = 8, [88] = 8, [89] = 8, [90] = 8, [97] = 8, [98] = 8, [99] = 8, [100] = 8, [101] = 8, [102] = 8, [103] = 8, [104] = 8, [105] = 8, [106] = 8, [107] = 8, [108] = 8, [109] = 8, [110] = 8, [111] = 8, [112] = 8, [113] = 8, [114] = 8, [115] = 8, [116] = 8, [117] = 8, [118] = 8, [119] = 8, [120] = 8, [121] = 8, [122] = 8, [123] = 9, [125] = 10}},
+	{TokenType_Whitespace, {[0] = 0, [9] = 2, [10] = 2, [13] = 2, [32] = 2}},
 	{TokenType_LeftParenthesis, {[0] = 0}},
-	{TokenType_RightBrace, {[0] = 0}},
-	{TokenType_Whitespace, {[0] = 0, [9] = 19, [10] = 19, [13] = 19, [32] = 19}},
 	{TokenType_RightParenthesis, {[0] = 0}},
-	{TokenType_KeywordReturn, {[0] = 0, [48] = 10, [49] = 10, [50] = 10, [51] = 10, [52] = 10, [53] = 10, [54] = 10, [55] = 10, [56] = 10, [57] = 10, [65] = 10, [66] = 10, [67] = 10, [68] = 10, [69] = 10, [70] = 10, [71] = 10, [72] = 10, [73] = 10, [74] = 10, [75] = 10, [76] = 10, [77] = 10, [78] = 10, [79] = 10, [80] = 10, [81] = 10, [82] = 10, [83] = 10, [84] = 10, [85] = 10, [86] = 10, [87] = 10, [88] = 10, [89] = 10, [90] = 10, [97] = 10, [98] = 10, [99] = 10, [100] = 10, [101] = 10, [102] = 10, [103] = 10, [104] = 10, [105] = 10, [106] = 10, [107] = 10, [108] = 10, [109] = 10, [110] = 10, [111] = 10, [112] = 10, [113] = 10, [114] = 10, [115] = 10, [116] = 10, [117] = 10, [118] = 10, [119] = 10, [120] = 10, [121] = 10, [122] = 10}},
+	{TokenType_CLex_Reject, {[0] = 0, [42] = 11, [47] = 12}},
+	{TokenType_Number, {[0] = 0, [48] = 6, [49] = 6, [50] = 6, [51] = 6, [52] = 6, [53] = 6, [54] = 6, [55] = 6, [56] = 6, [57] = 6}},
+	{TokenType_Semicolon, {[0] = 0}},
+	{TokenType_Identifier, {[0] = 0, [48] = 8, [49] = 8, [50] = 8, [51] = 8, [52] = 8, [53] = 8, [54] = 8, [55] = 8, [56] = 8, [57] = 8, [65] = 8, [66] = 8, [67] = 8, [68] = 8, [69] = 8, [70] = 8, [71] = 8, [72] = 8, [73] = 8, [74] = 8, [75] = 8, [76] = 8, [77] = 8, [78] = 8, [79] = 8, [80] = 8, [81] = 8, [82] = 8, [83] = 8, [84] = 8, [85] = 8, [86] = 8, [87] = 8, [88] = 8, [89] = 8, [90] = 8, [97] = 8, [98] = 8, [99] = 8, [100] = 8, [101] = 8, [102] = 8, [103] = 8, [104] = 8, [105] = 8, [106] = 8, [107] = 8, [108] = 8, [109] = 8, [110] = 8, [111] = 8, [112] = 8, [113] = 8, [114] = 8, [115] = 8, [116] = 8, [117] = 8, [118] = 8, [119] = 8, [120] = 8, [121] = 8, [122] = 8}},
 	{TokenType_LeftBrace, {[0] = 0}},
-	{TokenType_Number, {[0] = 0, [48] = 23, [49] = 23, [50] = 23, [51] = 23, [52] = 23, [53] = 23, [54] = 23, [55] = 23, [56] = 23, [57] = 23}},
-	{TokenType_Comment, {[0] = 0}}
+	{TokenType_RightBrace, {[0] = 0}},
+	{TokenType_CLex_Reject, {[0] = 0, [1] = 11, [2] = 11, [3] = 11, [4] = 11, [5] = 11, [6] = 11, [7] = 11, [8] = 11, [9] = 11, [10] = 11, [11] = 11, [12] = 11, [13] = 11, [14] = 11, [15] = 11, [16] = 11, [17] = 11, [18] = 11, [19] = 11, [20] = 11, [21] = 11, [22] = 11, [23] = 11, [24] = 11, [25] = 11, [26] = 11, [27] = 11, [28] = 11, [29] = 11, [30] = 11, [31] = 11, [32] = 11, [33] = 11, [34] = 11, [35] = 11, [36] = 11, [37] = 11, [38] = 11, [39] = 11, [40] = 11, [41] = 11, [42] = 13, [43] = 11, [44] = 11, [45] = 11, [46] = 11, [48] = 11, [49] = 11, [50] = 11, [51] = 11, [52] = 11, [53] = 11, [54] = 11, [55] = 11, [56] = 11, [57] = 11, [58] = 11, [59] = 11, [60] = 11, [61] = 11, [62] = 11, [63] = 11, [64] = 11, [65] = 11, [66] = 11, [67] = 11, [68] = 11, [69] = 11, [70] = 11, [71] = 11, [72] = 11, [73] = 11, [74] = 11, [75] = 11, [76] = 11, [77] = 11, [78] = 11, [79] = 11, [80] = 11, [81] = 11, [82] = 11, [83] = 11, [84] = 11, [85] = 11, [86] = 11, [87] = 11, [88] = 11, [89] = 11, [90] = 11, [91] = 11, [92] = 11, [93] = 11, [94] = 11, [95] = 11, [96] = 11, [97] = 11, [98] = 11, [99] = 11, [100] = 11, [101] = 11, [102] = 11, [103] = 11, [104] = 11, [105] = 11, [106] = 11, [107] = 11, [108] = 11, [109] = 11, [110] = 11, [111] = 11, [112] = 11, [113] = 11, [114] = 11, [115] = 11, [116] = 11, [117] = 11, [118] = 11, [119] = 11, [120] = 11, [121] = 11, [122] = 11, [123] = 11, [124] = 11, [125] = 11, [126] = 11, [127] = 11}},
+	{TokenType_CLex_Reject, {[0] = 0, [1] = 12, [2] = 12, [3] = 12, [4] = 12, [5] = 12, [6] = 12, [7] = 12, [8] = 12, [9] = 12, [10] = 14, [11] = 12, [12] = 12, [13] = 15, [14] = 12, [15] = 12, [16] = 12, [17] = 12, [18] = 12, [19] = 12, [20] = 12, [21] = 12, [22] = 12, [23] = 12, [24] = 12, [25] = 12, [26] = 12, [27] = 12, [28] = 12, [29] = 12, [30] = 12, [31] = 12, [32] = 12, [33] = 12, [34] = 12, [35] = 12, [36] = 12, [37] = 12, [38] = 12, [39] = 12, [40] = 12, [41] = 12, [42] = 12, [43] = 12, [44] = 12, [45] = 12, [46] = 12, [47] = 12, [48] = 12, [49] = 12, [50] = 12, [51] = 12, [52] = 12, [53] = 12, [54] = 12, [55] = 12, [56] = 12, [57] = 12, [58] = 12, [59] = 12, [60] = 12, [61] = 12, [62] = 12, [63] = 12, [64] = 12, [65] = 12, [66] = 12, [67] = 12, [68] = 12, [69] = 12, [70] = 12, [71] = 12, [72] = 12, [73] = 12, [74] = 12, [75] = 12, [76] = 12, [77] = 12, [78] = 12, [79] = 12, [80] = 12, [81] = 12, [82] = 12, [83] = 12, [84] = 12, [85] = 12, [86] = 12, [87] = 12, [88] = 12, [89] = 12, [90] = 12, [91] = 12, [92] = 12, [93] = 12, [94] = 12, [95] = 12, [96] = 12, [97] = 12, [98] = 12, [99] = 12, [100] = 12, [101] = 12, [102] = 12, [103] = 12, [104] = 12, [105] = 12, [106] = 12, [107] = 12, [108] = 12, [109] = 12, [110] = 12, [111] = 12, [112] = 12, [113] = 12, [114] = 12, [115] = 12, [116] = 12, [117] = 12, [118] = 12, [119] = 12, [120] = 12, [121] = 12, [122] = 12, [123] = 12, [124] = 12, [125] = 12, [126] = 12, [127] = 12}},
+	{TokenType_CLex_Reject, {[0] = 0, [1] = 11, [2] = 11, [3] = 11, [4] = 11, [5] = 11, [6] = 11, [7] = 11, [8] = 11, [9] = 11, [10] = 11, [11] = 11, [12] = 11, [13] = 11, [14] = 11, [15] = 11, [16] = 11, [17] = 11, [18] = 11, [19] = 11, [20] = 11, [21] = 11, [22] = 11, [23] = 11, [24] = 11, [25] = 11, [26] = 11, [27] = 11, [28] = 11, [29] = 11, [30] = 11, [31] = 11, [32] = 11, [33] = 11, [34] = 11, [35] = 11, [36] = 11, [37] = 11, [38] = 11, [39] = 11, [40] = 11, [41] = 11, [42] = 13, [43] = 11, [44] = 11, [45] = 11, [46] = 11, [47] = 14, [48] = 11, [49] = 11, [50] = 11, [51] = 11, [52] = 11, [53] = 11, [54] = 11, [55] = 11, [56] = 11, [57] = 11, [58] = 11, [59] = 11, [60] = 11, [61] = 11, [62] = 11, [63] = 11, [64] = 11, [65] = 11, [66] = 11, [67] = 11, [68] = 11, [69] = 11, [70] = 11, [71] = 11, [72] = 11, [73] = 11, [74] = 11, [75] = 11, [76] = 11, [77] = 11, [78] = 11, [79] = 11, [80] = 11, [81] = 11, [82] = 11, [83] = 11, [84] = 11, [85] = 11, [86] = 11, [87] = 11, [88] = 11, [89] = 11, [90] = 11, [91] = 11, [92] = 11, [93] = 11, [94] = 11, [95] = 11, [96] = 11, [97] = 11, [98] = 11, [99] = 11, [100] = 11, [101] = 11, [102] = 11, [103] = 11, [104] = 11, [105] = 11, [106] = 11, [107] = 11, [108] = 11, [109] = 11, [110] = 11, [111] = 11, [112] = 11, [113] = 11, [114] = 11, [115] = 11, [116] = 11, [117] = 11, [118] = 11, [119] = 11, [120] = 11, [121] = 11, [122] = 11, [123] = 11, [124] = 11, [125] = 11, [126] = 11, [127] = 11}},
+	{TokenType_Comment, {[0] = 0}},
+	{TokenType_CLex_Reject, {[0] = 0, [10] = 14}}
 };
 
 static const size_t k_initialState = 1;
 
-TokenType CLex(const char **input)
+#define CLEX_KEYWORD_SIZE_MAX 6
+
+typedef struct CLexKeyword CLexKeyword;
+struct CLexKeyword
+{
+	const char *text;
+	size_t size;
+	TokenType base;
+	TokenType type;
+};
+
+static const CLexKeyword k_keywords[] =
+{
+	{"return", 6, TokenType_Identifier, TokenType_KeywordReturn},
+	{"int", 3, TokenType_Identifier, TokenType_KeywordInt}
+};
+
+static const uint32_t k_keywordSeeds[] =
+{
+	0, 0
+};
+
+static TokenType CLex_Classify(TokenType type, const char *token, size_t size)
+{
+	if ((type != TokenType_Identifier) || size - 1 >= CLEX_KEYWORD_SIZE_MAX)
+	{
+		return type;
+	}
+	
+	uint64_t key = (uint64_t)size;
+	key |= (uint64_t)(unsigned char)token[0] << 8;
+	key |= (uint64_t)(unsigned char)token[size - 1] << 16;
+	uint64_t bucket = (((key * 0x9E3779B97F4A7C15ull) >> 32) * 2u) >> 32;
+	uint64_t slot = (((key ^ k_keywordSeeds[bucket]) * 0xC2B2AE3D27D4EB4Full) >> 32) * 2u >> 32;
+	const CLexKeyword *keyword = &k_keywords[slot];
+	if (keyword->base == type && keyword->size == size && !memcmp(keyword->text, token, size))
+	{
+		return keyword->type;
+	}
+	return type;
+}
+
+static TokenType CLex_Match(const char **input)
 {
 	size_t lastState = k_initialState;
 	size_t state = k_states[lastState].edges[**input];
@@ -51,4 +98,65 @@ TokenType CLex(const char **input)
 		state = k_states[lastState].edges[**input];
 	}
 	return k_states[lastState].type;
+}
+
+TokenType CLex(const char **input)
+{
+	const char *begin = *input;
+	TokenType type = CLex_Match(input);
+	return CLex_Classify(type, begin, (size_t)(*input - begin));
+}
+
+#if !defined(CLEX_SSSE3)
+static const unsigned char k_recoverStops[256] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0};
+#else
+static const unsigned char k_recoverLowMasks[16] = {0xAD, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xFC, 0xFD, 0xF1, 0xD8, 0x50, 0xD1, 0x50, 0x54};
+static const unsigned char k_recoverHighMasks[16] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+
+#if defined(_MSC_VER)
+static unsigned CLex_FirstBit(unsigned mask)
+{
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (unsigned)index;
+}
+#else
+#define CLex_FirstBit(mask) ((unsigned)__builtin_ctz(mask))
+#endif
+
+/* Looks up both nibbles of every byte in the block at once; a byte is a stop if its
+ * masks share a bit */
+static unsigned CLex_FindStops(const unsigned char *block, const unsigned char *lowMasks)
+{
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+	__m128i bytes = _mm_load_si128((const __m128i *)block);
+	__m128i low = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)lowMasks), _mm_and_si128(bytes, nibble));
+	__m128i high = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)k_recoverHighMasks), _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+	__m128i misses = _mm_cmpeq_epi8(_mm_and_si128(low, high), _mm_setzero_si128());
+	return ~(unsigned)_mm_movemask_epi8(misses) & 0xFFFF;
+}
+#endif
+
+size_t CLex_Recover(const char **input)
+{
+	const unsigned char *begin = (const unsigned char *)*input;
+	const unsigned char *cursor = begin;
+#if defined(CLEX_SSSE3)
+	/* Aligned blocks never cross a page boundary, so reading past the NUL is safe */
+	const unsigned char *block = (const unsigned char *)((uintptr_t)begin & ~(uintptr_t)15);
+	unsigned found = CLex_FindStops(block, k_recoverLowMasks) & (0xFFFFu << (begin - block));
+	while (!found)
+	{
+		block += 16;
+		found = CLex_FindStops(block, k_recoverLowMasks);
+	}
+	cursor = block + CLex_FirstBit(found);
+#else
+	while (!k_recoverStops[*cursor])
+	{
+		++cursor;
+	}
+#endif
+	*input = (const char *)cursor;
+	return (size_t)(cursor - begin);
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 /* Generated by CLex */
 
+#define CLEX_GRAMMAR_HASH 0x1F072DE144917459ull
+
+#include <stddef.h>
+
 typedef enum TokenType
 {
 	TokenType_CLex_Reject,
@@ -16,4 +20,9 @@ typedef enum TokenType
 	TokenType_Whitespace
 } TokenType;
 
-TokenType CLex(const char **input);
\ No newline at end of file
+TokenType CLex(const char **input);
+
+/* Error recovery: after CLex returns TokenType_CLex_Reject, skips *input ahead to the
+ * next byte that can start a token, or to the terminating NUL, and returns the number
+ * of bytes skipped. Together with the rejected token, they form one error span. */
+size_t CLex_Recover(const char **input);
\ No newline at end of file